@@ -5,6 +5,9 @@
 #include "dataset.hpp"
 #include "params.hpp"
 #include "cluster_info.hpp"
+#include "strategies.hpp"
+#include "rng.hpp"
+#include "parallel.hpp"
 #include <time.h>
 
 // global program parameters
@@ -15,8 +18,6 @@ double delta, epsilon = 0.01;		// curve lsh (frechet)
 
 int main(int argc, char const *argv[])
 {
-	srand (time(NULL));
-
 	// variables for program input files
 	std::string input_file, config_file, output_file;
 	
@@ -32,14 +33,54 @@ int main(int argc, char const *argv[])
 	// method for centroid-update part of clustering
 	std::string update_method; 		// update method is either Mean Frechet or Mean Vector
 
+	// seed of the random generator used for centroid initialization and the hash functions (negative if not given)
+	long long seed;
+
+	// tuned file : parameters of the search structure chosen by search -tune (empty if not given)
+	std::string tuned_file;
+
+	// number of threads of the assignment and update steps (0 for as many as the hardware threads)
+	int threads;
+
+	// batch size and number of iterations of mini-batch k-means, and whether it ends with an exact assignment of all objects
+	int batch_size, batch_iterations;
+	bool full_assignment;
+
+	// centroid initialization (KMeans++ or KMeansParallel), and the oversampling of k-means|| (0 for the default)
+	std::string init_method;
+	double oversampling;
+
 	// check for input args and initialize them
-	if (!check_init_args(argc, argv, input_file, config_file, output_file, update_method, assignment_method, complete, silhouette))
+	if (!check_init_args(argc, argv, input_file, config_file, output_file, update_method, assignment_method, complete, silhouette, seed, tuned_file, threads,
+		batch_size, batch_iterations, full_assignment, init_method, oversampling))
 		return EXIT_FAILURE;
+
+	if (threads > 0)
+		set_num_threads(threads);
 	
 	// check for config file args and initialize them
 	if (!check_init_config_args(config_file, K, L, k, M, d1, probes))
 		return EXIT_FAILURE;
 
+	// parameters of a tuning run replace the ones of the config file, if they were tuned for the structure of the assignment method
+	int tuned_w = 0;
+	double tuned_delta = 0.0;
+	if (!tuned_file.empty())
+	{
+		std::string tuned_algorithm, tuned_metric;
+		if (!read_tuned_file(tuned_file, tuned_algorithm, tuned_metric, k, L, d1, M, probes, tuned_w, tuned_delta))
+			return EXIT_FAILURE;
+
+		bool matches = (assignment_method == "LSH" && tuned_algorithm == "LSH") || (assignment_method == "Hypercube" && tuned_algorithm == "Hypercube" && tuned_metric.empty())
+			|| (assignment_method == "LSH_Frechet" && tuned_algorithm == "Frechet" && tuned_metric == "discrete");
+		if (!matches)
+		{
+			std::cerr << "\nGiven tuned file was tuned for algorithm " << tuned_algorithm << (tuned_metric.empty() ? "" : " " + tuned_metric);
+			std::cerr << ", it does not match assignment method " << assignment_method << "\n\n";
+			return EXIT_FAILURE;
+		}
+	}
+
 	// read input file and initialize arguments n and d
 	if (!read_input_file(input_file, n, d))
 	{
@@ -47,8 +88,8 @@ int main(int argc, char const *argv[])
 		return EXIT_FAILURE;
 	}
 
-	// pointer to metric function to be used
-	double (*metric_function)(const Abstract_Object &, const Abstract_Object &);
+	// a single generator, seeded once, is used for every random choice of the clustering (same seed gives the same clustering)
+	rng generator(seed >= 0 ? (uint64_t) seed : random_seed());
 
 	if (update_method == "Mean Frechet")
 		algorithm = "Frechet";
@@ -64,14 +105,14 @@ int main(int argc, char const *argv[])
 	if (algorithm == "Frechet")
 	{
 		metric_func = "discrete";
-		metric_function = discrete_frechet;
 		// delta << 4 * dim of grid * min {m1, m2} ,  dim of grid = 2, m1=m2=d for our case
 		delta = (8 * d) * 0.000205479452054;					// experimental value (testing required)
+		if (tuned_delta > 0)
+			delta = tuned_delta;
 	}
 	else
 	{
 		metric_func = "";
-		metric_function = euclidean;
 	}
 
 	std::cout << "\nReading Input Dataset  --> ";
@@ -79,13 +120,28 @@ int main(int argc, char const *argv[])
 	Dataset dataset(n, input_file);
 	std::cout << "Completed\n";
 
-	w = 50;
+	w = (tuned_w > 0) ? tuned_w : 50;
+
+	bool clustered;
 
 	// create a cluster object that will hold info necessary for clustering
-	Cluster_info cluster_info;
+	// and execute clustering using given update_method, assignment_method, and output results into output file
+	// the metric is fixed by the cluster object type : discrete frechet for curves, euclidean for vectors
+	if (algorithm == "Frechet")
+	{
+		Cluster_info<discrete_frechet_strategy> cluster_info(generator);
+		cluster_info.set_init(init_method, oversampling);
+		clustered = cluster_info.execute(dataset, output_file, update_method, assignment_method, complete, silhouette);
+	}
+	else
+	{
+		Cluster_info<vector_strategy> cluster_info(generator);
+		cluster_info.set_mini_batch(batch_size, batch_iterations, full_assignment);
+		cluster_info.set_init(init_method, oversampling);
+		clustered = cluster_info.execute(dataset, output_file, update_method, assignment_method, complete, silhouette);
+	}
 
-	// executes clustering using given update_method, assignment_method and metric, and outputs results into output file
-	if (!cluster_info.execute(dataset, output_file, update_method, assignment_method, complete, silhouette, metric_function))
+	if (!clustered)
 	{
 		std::cerr << "\nError occured while opening given output file\n\n";
 		return EXIT_FAILURE;
@@ -3,6 +3,7 @@
 #include "object.hpp"
 #include "assist_functions.hpp"
 #include "cbtree.hpp"
+#include "parallel.hpp"
 #include <list>
 
 void CBTree::destroy(node *node_ptr)
@@ -48,27 +49,6 @@ CBTree::node * CBTree::full_binary_tree(unsigned int height, std::list <node *>
 	return root_node;
 }
 
-Abstract_Object * CBTree::post_order_traversal(node * cur_node)
-{
-	// if current node is leaf
-	if (cur_node->left == nullptr && cur_node->right == nullptr)
-		return cur_node->curve;
-	else
-	{
-		//since it is not a leaf, and tree is a complete binary tree, cur_node->left is not null
-		// compute mean curve of left subtree
-		Abstract_Object * left_curve = post_order_traversal(cur_node->left);
-		// compute mean curve of right subtree
-		Abstract_Object * right_curve = nullptr;
-		if (cur_node->right != nullptr)
-			right_curve = post_order_traversal(cur_node->right);
-
-		// mean curve of current node is mean curve of left curve and right curve
-		cur_node->curve = mean_curve(left_curve, right_curve);
-		return cur_node->curve;
-	}
-}
-
 CBTree::CBTree(const std::vector <const Abstract_Object*> & cluster)
 {   
     // find h = biggest power of 2, smaller than the size of the cluster h = O(#curves)
@@ -94,7 +74,7 @@ CBTree::CBTree(const std::vector <const Abstract_Object*> & cluster)
     // assign h of cluster's curves to the leaves of that tree (h <= #curves <= 2*h)
     for (auto const& node : leaves) 
     {
- 	   node->curve = new time_series(*cluster[index]);
+ 	   node->view = cluster[index];
  	   index++;
 	}
 
@@ -109,11 +89,11 @@ CBTree::CBTree(const std::vector <const Abstract_Object*> & cluster)
     	cur_node->left = new node();
     	cur_node->right = new node();
     	// left leaf node curve of next level becomes curve of former leaf node of last level
-    	cur_node->left->curve = cur_node->curve;
+    	cur_node->left->view = cur_node->view;
     	// right leaf node curve of next level becomes new curve
-    	cur_node->right->curve = new time_series(*cluster[index]);
+    	cur_node->right->view = cluster[index];
     	// former leaf node of last level, has no curve assigned now
-    	cur_node->curve = nullptr;
+    	cur_node->view = nullptr;
     	index++;
     }
 }
@@ -124,10 +104,79 @@ CBTree::~CBTree()
 }
 
 
-Abstract_Object * CBTree::post_order_traversal()
+Abstract_Object * CBTree::reduce(rng & generator)
 {
-	Abstract_Object * mean_curve = this->post_order_traversal(this->root);
-	if (mean_curve == nullptr)
-		std::cerr << "CBTree::post_order_traversal -> Error: Expected non-null mean_curve\n\n";
-	return new time_series(*mean_curve);
+	if (this->root == nullptr)
+		return nullptr;
+
+	// collect the nodes of each level of the tree, top down
+	std::vector <std::vector <node *> > levels(1, std::vector <node *>(1, this->root));
+	while (true)
+	{
+		std::vector <node *> next_level;
+		for (node * cur_node : levels.back())
+		{
+			if (cur_node->left != nullptr)
+				next_level.push_back(cur_node->left);
+			if (cur_node->right != nullptr)
+				next_level.push_back(cur_node->right);
+		}
+		if (next_level.empty())
+			break;
+		levels.push_back(next_level);
+	}
+
+	// seeds of the merges : each node is numbered by its position in the levels (top down, left to right)
+	uint64_t base_seed = generator.next();
+	std::vector <uint64_t> first_index(levels.size(), 0);
+	for (size_t l = 1; l < levels.size(); ++l)
+		first_index[l] = first_index[l-1] + levels[l-1].size();
+
+	// merge bottom up, the nodes of a level are independent of each other
+	for (int l = (int) levels.size() - 1; l >= 0; --l)
+	{
+		std::vector <node *> & level = levels[l];
+
+		parallel_for(level.size(), parallel_threads(level.size(), 1), [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				node * cur_node = level[i];
+				if (cur_node->left == nullptr)
+					continue;		// leaf
+
+				if (cur_node->right == nullptr)
+				{
+					// single child, its curve is passed up as it is
+					cur_node->curve = cur_node->left->curve;
+					cur_node->view = cur_node->left->view;
+					cur_node->left->curve = nullptr;
+					continue;
+				}
+
+				// mean curve of current node is mean curve of left curve and right curve
+				rng node_generator(mix64(base_seed + first_index[l] + i));
+				cur_node->curve = mean_curve(cur_node->left->view, cur_node->right->view, node_generator);
+				cur_node->view = cur_node->curve;
+
+				// curves of the children are no longer needed
+				delete cur_node->left->curve;
+				cur_node->left->curve = nullptr;
+				delete cur_node->right->curve;
+				cur_node->right->curve = nullptr;
+			}
+		});
+	}
+
+	if (this->root->view == nullptr)
+		std::cerr << "CBTree::reduce -> Error: Expected non-null mean_curve\n\n";
+
+	// the mean curve of the root is handed over to the caller (a cluster of a single curve has no mean curve computed, it is copied)
+	if (this->root->curve != nullptr)
+	{
+		Abstract_Object * mean = this->root->curve;
+		this->root->curve = nullptr;
+		return mean;
+	}
+	return new time_series(*this->root->view);
 }
@@ -4,6 +4,8 @@
 #include <iostream>
 #include "object.hpp"
 #include <list>
+#include <vector>
+#include "rng.hpp"
 
 // class for complete binary tree, used to find mean curve in clustering
 class CBTree
@@ -12,12 +14,13 @@ private:
 	//node of tree implemented with a struct
 	struct node 
 	{
-		Abstract_Object * curve;	// pointer to Abstract Object curve of node
+		Abstract_Object * curve;		// mean curve computed at node (owned), nullptr for leaves and once consumed by the parent node
+		const Abstract_Object * view;	// curve of node : a curve of the cluster for leaves (not copied), the mean curve otherwise
 		node * left;
 		node * right;
 		
 		// default constructor for tree node
-		node() : curve(nullptr), left(nullptr), right(nullptr){}
+		node() : curve(nullptr), view(nullptr), left(nullptr), right(nullptr){}
 		
 		// destructor
 		~node()
@@ -33,8 +36,6 @@ private:
 	void destroy(node * node_ptr);
 	// creates a full binary tree of given height, and returns its root, and its leaves in leaves list
 	CBTree::node * full_binary_tree(unsigned int height, std::list <node *> & leaves);
-	// helper function for post_order_traversal (this function does the actual work xddd)
-	Abstract_Object * post_order_traversal(node * root);
 
 
 public:
@@ -42,9 +43,12 @@ public:
 	CBTree(const std::vector <const Abstract_Object*> & cluster);
 	// destructor
 	~CBTree();
-	// traverses the nodes of tree in post order fashion and computes mean curves bottom up for each internal node
-	// returns the final mean curve of root node
-	Abstract_Object * post_order_traversal();
+	// computes mean curves bottom up, one level of the tree at a time (the nodes of a level are merged in parallel)
+	// the curves of the children of a node are freed as soon as the node's mean curve is computed
+	// each merge draws its random choices from its own generator, seeded from given generator and the position of the node,
+	// so the mean curve does not depend on the number of threads
+	// returns the final mean curve of root node (owned by the caller)
+	Abstract_Object * reduce(rng & generator);
 };
 
 #endif
\ No newline at end of file
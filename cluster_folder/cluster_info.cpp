@@ -11,6 +11,7 @@
 #include <limits>
 #include <map>
 #include <cfloat>
+#include <algorithm>
 #include "params.hpp"
 #include "dataset.hpp"
 #include "object.hpp"
@@ -18,9 +19,13 @@
 #include "lsh_struct.hpp"
 #include "hypercube_class.hpp"
 #include "cbtree.hpp"
+#include "strategies.hpp"
+#include "parallel.hpp"
 
 
-Cluster_info::Cluster_info()
+template <typename Strategy>
+Cluster_info<Strategy>::Cluster_info(rng & generator) : generator(generator), centroid_shifts(K, 0.0), distance_evaluations(0), lloyds_distances(0), skipped_distances(0),
+	batch_size(MINI_BATCH_SIZE), batch_iterations(MINI_BATCH_ITERATIONS), full_assignment(false), init_method("KMeans++"), oversampling(KMEANS_PARALLEL_OVERSAMPLING)
 {
 	// initialize a d-zero vector that will be used to initialize the K centroids
 	std::vector <float> input_vector(d);
@@ -28,17 +33,9 @@ Cluster_info::Cluster_info()
 		input_vector[i] = 0;
 
 	// initialize the vector that will hold the K centroids
+	// centroids are of the object type of the strategy (time_series type objects when algorithm is Frechet, Object type objects otherwise)
 	for (int i = 0; i < K; ++i)
-	{
-		if (algorithm == "Frechet")
-		{
-			centroids.push_back(new time_series(input_vector));		// centroids are time_series type objects when algorithm is Frechet
-		}
-		else
-		{
-			centroids.push_back(new Object(input_vector));			// centroids are Object type objects when algorithm is not Frechet
-		}
-	}
+		centroids.push_back(new typename Strategy::object_type(input_vector));
 
 	// initialize the vector of clusters
 	for (int i = 0; i < K; ++i)
@@ -49,23 +46,48 @@ Cluster_info::Cluster_info()
 
 }
 
-Cluster_info::~Cluster_info()
+template <typename Strategy>
+void Cluster_info<Strategy>::set_mini_batch(int batch_size, int batch_iterations, bool full_assignment)
+{
+	// non positive values keep the defaults
+	if (batch_size > 0)
+		this->batch_size = batch_size;
+	if (batch_iterations > 0)
+		this->batch_iterations = batch_iterations;
+	this->full_assignment = full_assignment;
+}
+
+template <typename Strategy>
+void Cluster_info<Strategy>::set_init(const std::string & init_method, double oversampling)
+{
+	this->init_method = init_method;
+	// non positive oversampling keeps the default
+	if (oversampling > 0)
+		this->oversampling = oversampling;
+}
+
+template <typename Strategy>
+Cluster_info<Strategy>::~Cluster_info()
 {
 	for (int i = 0; i < K; ++i)
 		delete(centroids[i]);		// delete dynamically allocated centroid abstract objects
 }
 
 
-bool Cluster_info::execute(const Dataset & dataset, const std::string & output_file, const std::string & update_method, const std::string & assignment_method, bool complete, bool run_silhouette, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+bool Cluster_info<Strategy>::execute(const Dataset & dataset, const std::string & output_file, const std::string & update_method, const std::string & assignment_method, bool complete, bool run_silhouette)
 {
 	std::ofstream file (output_file, std::ios::out);		// open output file for output operations
 	
 	if (!file.is_open())			// check if file was opened properly
 	    return false;				// error occured
 
-	std::cout << "Initializing Centroids --> ";
-	// uses the dataset given, to run K-means++ initialization and find K initial centroids
-	K_means_init(dataset, metric);
+	std::cout << "Initializing Centroids (" << this->init_method << ") --> ";
+	// uses the dataset given, to run K-means++ (or k-means||) initialization and find K initial centroids
+	if (this->init_method == "KMeansParallel")
+		K_means_parallel_init(dataset, this->generator);
+	else
+		K_means_init(dataset, this->generator);
 	std::cout << "Completed\n";
 
 	//start timer for clustering
@@ -75,22 +97,38 @@ bool Cluster_info::execute(const Dataset & dataset, const std::string & output_f
 
 	if (assignment_method == "Classic")
 	{
-		exact_lloyds(dataset, update_method, metric);
+		exact_lloyds(dataset, update_method);
 		file << "Algorithm: Assignment --> Lloyds , Update --> " << update_method << " \n";
 	}
+	else if (assignment_method == "Elkan")
+	{
+		elkan_clustering(dataset, update_method);
+		file << "Algorithm: Assignment --> Lloyds (Elkan bounds) , Update --> " << update_method << " \n";
+	}
+	else if (assignment_method == "Hamerly")
+	{
+		hamerly_clustering(dataset, update_method);
+		file << "Algorithm: Assignment --> Lloyds (Hamerly bounds) , Update --> " << update_method << " \n";
+	}
+	else if (assignment_method == "MiniBatch")
+	{
+		mini_batch_clustering(dataset);
+		file << "Algorithm: Assignment --> Mini-batch (batch size " << this->batch_size << " , iterations " << this->batch_iterations;
+		file << (this->full_assignment ? " , full assignment" : " , clusters of last batch") << ") , Update --> " << update_method << " \n";
+	}
 	else if (assignment_method == "LSH")
 	{
-		lsh_range_search_clustering(dataset, update_method, metric);
+		lsh_range_search_clustering(dataset, update_method);
 		file << "Algorithm: Assignment --> Range Search LSH , Update --> " << update_method << " \n";
 	}
 	else if (assignment_method == "Hypercube")
 	{
-		cube_range_search_clustering(dataset, update_method, metric);
+		cube_range_search_clustering(dataset, update_method);
 		file << "Algorithm: Assignment --> Range Search Hypercube , Update --> " << update_method << " \n";
 	}
 	else if (assignment_method == "LSH_Frechet")
 	{
-		frechet_range_search_clustering(dataset, update_method, metric);
+		frechet_range_search_clustering(dataset, update_method);
 		file << "Algorithm: Assignment --> Range Search Frechet , Update --> " << update_method << " \n";
 	}
 
@@ -112,6 +150,14 @@ bool Cluster_info::execute(const Dataset & dataset, const std::string & output_f
 	// write times of execution in file
 	file << "clustering_time : " <<  time.count() << "s\n\n";
 
+	// the triangle inequality assignments report the distances their bounds saved
+	if (assignment_method == "Elkan" || assignment_method == "Hamerly")
+	{
+		file << "distance_evaluations : " << this->distance_evaluations << " , skipped : " << this->skipped_distances;
+		file << " (of " << this->lloyds_distances << " evaluated by exact lloyd's)\n\n";
+		std::cout << "Distance evaluations = " << this->distance_evaluations << " , skipped = " << this->skipped_distances << "\n";
+	}
+
 	// if silhouette option was given, run silhouette metric as well
 	if (run_silhouette == true)
 	{
@@ -120,7 +166,7 @@ bool Cluster_info::execute(const Dataset & dataset, const std::string & output_f
 		//start timer for silhouette
 		auto s_start = std::chrono::high_resolution_clock::now();
 		
-		std::vector<double> silhouette = this->silhouette(metric);
+		std::vector<double> silhouette = this->silhouette();
 		
 		// end timer for silhouette
 		auto s_end = std::chrono::high_resolution_clock::now();
@@ -159,16 +205,13 @@ bool Cluster_info::execute(const Dataset & dataset, const std::string & output_f
 	return true;
 }
 
-void Cluster_info::K_means_init(const Dataset & dataset, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+void Cluster_info<Strategy>::K_means_init(const Dataset & dataset, rng & generator)
 {
 	// following block of code picks a uniformly random integer that will serve as the initial centroid index
 	const int num_of_Objects = dataset.get_num_of_Objects();
-
-	std::random_device rd;
-	std::mt19937 generator(rd());
-	std::uniform_int_distribution<int> distr(0, num_of_Objects - 1);	
 		
-	int initial_centroid = distr(generator);		// pick a random index as the initial centroid index
+	int initial_centroid = generator.uniform_int(0, num_of_Objects - 1);		// pick a random index as the initial centroid index
 	int centroid_index = initial_centroid;
 	int t = 1;
 
@@ -176,307 +219,726 @@ void Cluster_info::K_means_init(const Dataset & dataset, double (*metric)(const
 	centroids[0]->set(dataset.get_ith_object(initial_centroid));
 
 	// array D will hold min distance to some centroid for every Abstract Object
-	std::vector <float> D(num_of_Objects);
+	std::vector <float> D(num_of_Objects, FLT_MAX);
 	// array holding for each object, its nearest centroid thus far (if object is centroid, nearest centroid is itself) 
-	std::vector <int> nearest_centroid(num_of_Objects);
+	std::vector <int> nearest(num_of_Objects, -1);
 	// nearest centroid for the initial centroid is itself
-	nearest_centroid[initial_centroid] = initial_centroid;
+	nearest[initial_centroid] = initial_centroid;
 	D[initial_centroid] = 0;
 
+	// array that will hold the partial sums, for each non centroid Abstract Object, and the Abstract Object index of each partial sum in P
+	// (allocated once, each round uses its first num_of_Objects - t + 1 entries)
+	std::vector <float> P(num_of_Objects);
+	std::vector <int> object_index(num_of_Objects);
+
+	// the distances to each new centroid are computed in parallel, each thread keeps the max Di of its chunk
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	std::vector <float> partial_max(threads);
+
 	// repeat until K centroids have been selected
 	while (t < K)
 	{
-		// array that will hold the partial sums, for each non centroid Abstract Object
-		std::vector <float> P(num_of_Objects - t + 1);
-		// array that will hold the Abstract Object index of each partial sum in P
-		std::vector <int> object_index(num_of_Objects - t + 1);
-
-		int index = 1;
-		float max_Di = 0;
-
-		for (int i = 0; i < num_of_Objects; ++i)
+		parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
 		{
-			// initialize D array of distances and nearest_centroid array on first iteration
-			if (t == 1 && i != initial_centroid)
+			float max_Di = 0;
+			for (int i = begin; i < end; ++i)
 			{
-				D[i] = FLT_MAX;
-				nearest_centroid[i] = -1;
-			}
-
-			// for each non-centroid Abstract Object			
-			if (nearest_centroid[i] != i)
-			{
-				const Abstract_Object * object = & dataset.get_ith_object(i);
-				float dist;
-
-				// if distance to newly added centroid, is smaller than min distance to any centroid thus far
-				if ((dist = (*metric)(*centroids[t-1], *object)) < D[i])
+				// for each non-centroid Abstract Object
+				if (nearest[i] != i)
 				{
-					D[i] = dist;								// update min distance
-					nearest_centroid[i] = centroid_index;		// update nearest centroid
-				}
+					const Abstract_Object * object = & dataset.get_ith_object(i);
+					float dist;
+
+					// if distance to newly added centroid, is smaller than min distance to any centroid thus far
+					// (the distance is abandoned once it exceeds D[i])
+					if ((dist = Strategy::bounded_distance(*centroids[t-1], *object, D[i])) < D[i])
+					{
+						D[i] = dist;								// update min distance
+						nearest[i] = centroid_index;				// update nearest centroid
+					}
 
-				max_Di =  (D[i] > max_Di) ? D[i] : max_Di;	// update max Di
-				object_index[index++] = i;					// save non centroid object's index
+					max_Di =  (D[i] > max_Di) ? D[i] : max_Di;	// update max Di
+				}
 			}
-		}
+			partial_max[thread] = max_Di;
+		});
 
-		
-		// calculate the array of partial sums P
+		float max_Di = 0;
+		for (int i = 0; i < threads; ++i)
+			max_Di = (partial_max[i] > max_Di) ? partial_max[i] : max_Di;
+
+		// calculate the array of partial sums P, in object order
 		P[0] = 0; object_index[0] = 0;
-		
-		for (int i = 1; i < num_of_Objects - t + 1; i++)	
+		int index = 1;
+
+		for (int i = 0; i < num_of_Objects; i++)
 		{
-			P[i] = P[i-1] + (D[object_index[i]] * D[object_index[i]]) / (max_Di * max_Di);	// we divide each D[i] by max_Di to avoid P[i] being very large
+			if (nearest[i] != i)
+			{
+				object_index[index] = i;					// save non centroid object's index
+				P[index] = P[index-1] + (D[i] * D[i]) / (max_Di * max_Di);	// we divide each D[i] by max_Di to avoid P[i] being very large
+				index++;
+			}
 		}
 
 		// now we pick a uniformly distributed float x in [0, P[num_of_Objects - t]]
-		// picks a uniformly random integer that will serve as the initial centroid
-		std::random_device rd_float;
-		std::mt19937 generator_float(rd_float());
-		std::uniform_real_distribution<float> distr_float(0, P[num_of_Objects - t]);
-
-		float x = distr_float(generator_float);
+		float x = generator.uniform(0, P[num_of_Objects - t]);
 
-		// use binary search to find r (object index) in P, that maximizes probabilty proportional to D(i)^2
+		// find r (object index) in P, that maximizes probabilty proportional to D(i)^2, i.e the first r > 0 with P[r-1] < x <= P[r]
 		// the r found, will be the index of the new centroid to be added
-		int r = binary_search(P, x, 0, num_of_Objects - t);
+		int r = std::lower_bound(P.begin() + 1, P.begin() + num_of_Objects - t + 1, x) - P.begin();
+		r = std::min(r, num_of_Objects - t);
 
 		// update centroid_index to be equal to index of new centroid
 		centroid_index = object_index[r];
 		t++;
 		// set new centroid
 		centroids[t-1]->set(dataset.get_ith_object(centroid_index));
-		nearest_centroid[centroid_index] = centroid_index;
+		nearest[centroid_index] = centroid_index;
 		D[centroid_index] = 0;
 	}	
 }
 
-int binary_search(const std::vector <float> & P, float x, int lower_index, int upper_index)
+// k-means|| : starts from a random object, and in each of KMEANS_PARALLEL_ROUNDS rounds samples every object independently
+// with probability oversampling * K * D(i)^2 / sum of D(j)^2 (D is the distance to the nearest candidate so far)
+// each candidate is then weighted by the number of objects nearest to it, and K centroids are picked among the candidates by weighted K-means++
+template <typename Strategy>
+void Cluster_info<Strategy>::K_means_parallel_init(const Dataset & dataset, rng & generator)
 {
-	if (upper_index >= lower_index)
+	const int num_of_Objects = dataset.get_num_of_Objects();
+	const double expected_samples = this->oversampling * K;		// expected number of candidates sampled in each round
+
+	std::vector <int> candidates;								// dataset indices of the candidates
+	std::vector <bool> is_candidate(num_of_Objects, false);
+	std::vector <double> D(num_of_Objects, std::numeric_limits<double>::infinity());	// distance of each object to its nearest candidate
+	std::vector <int> owner(num_of_Objects, 0);					// nearest candidate of each object (position in candidates)
+
+	int first = generator.uniform_int(0, num_of_Objects - 1);
+	candidates.push_back(first);
+	is_candidate[first] = true;
+
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	int updated = 0;		// candidates already accounted for in D
+
+	for (int round = 0; ; ++round)
 	{
-		int r = lower_index + (upper_index - lower_index) / 2;
-		if (r == 0)
-			return 1;
+		// update D with the candidates sampled in the previous round (a distance is abandoned once it exceeds D[i])
+		int new_candidates = candidates.size();
+		parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				const Abstract_Object & object = dataset.get_ith_object(i);
+				for (int c = updated; c < new_candidates; ++c)
+				{
+					double dist = Strategy::bounded_distance(object, dataset.get_ith_object(candidates[c]), D[i]);
+					if (dist < D[i])
+					{
+						D[i] = dist;
+						owner[i] = c;
+					}
+				}
+			}
+		});
+		updated = new_candidates;
 
-		if ( P[r - 1] < x && x <= P[r] )
-			return r;
+		if (round == KMEANS_PARALLEL_ROUNDS)
+			break;
 
-		if (x > P[r])
-			return binary_search(P, x, r+1, upper_index);
+		double cost = 0.0;
+		for (int i = 0; i < num_of_Objects; ++i)
+			cost += D[i] * D[i];
+
+		if (cost == 0)		// every object coincides with a candidate
+			break;
 
-		if (x <= P[r - 1])
-			return binary_search(P, x, lower_index, r - 1);
+		// sampling draws one number per object, in object order, so candidates depend only on the seed
+		for (int i = 0; i < num_of_Objects; ++i)
+		{
+			if (generator.uniform() < expected_samples * D[i] * D[i] / cost && !is_candidate[i])
+			{
+				candidates.push_back(i);
+				is_candidate[i] = true;
+			}
+		}
 	}
 
-	return 0;
-}
+	// in the unlikely case of less candidates than clusters, random objects are added (they own only themselves)
+	while ((int) candidates.size() < K && (int) candidates.size() < num_of_Objects)
+	{
+		int i = generator.uniform_int(0, num_of_Objects - 1);
+		if (!is_candidate[i])
+		{
+			owner[i] = candidates.size();
+			candidates.push_back(i);
+			is_candidate[i] = true;
+		}
+	}
+
+	const int num_of_candidates = candidates.size();
+
+	// weight of each candidate : number of objects whose nearest candidate it is
+	std::vector <double> weight(num_of_candidates, 0.0);
+	for (int i = 0; i < num_of_Objects; ++i)
+		weight[owner[i]]++;
+
+	// weighted K-means++ over the candidates
+	std::vector <double> Dc(num_of_candidates, std::numeric_limits<double>::infinity());	// distance of each candidate to its nearest centroid
+	std::vector <double> P(num_of_candidates);
+	int candidate_threads = parallel_threads(num_of_candidates, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	int chosen = -1;
 
+	for (int t = 0; t < K && t < num_of_candidates; ++t)
+	{
+		// partial sums of the candidate weights (the first centroid), or of weight * Dc^2
+		double sum = 0.0;
+		for (int c = 0; c < num_of_candidates; ++c)
+		{
+			sum += (t == 0) ? weight[c] : weight[c] * Dc[c] * Dc[c];
+			P[c] = sum;
+		}
 
+		if (sum > 0)
+		{
+			double x = generator.uniform() * sum;
+			chosen = std::upper_bound(P.begin(), P.end(), x) - P.begin();
+			chosen = std::min(chosen, num_of_candidates - 1);
+		}
+		else
+		{
+			// every candidate left coincides with a centroid, pick any candidate that is not a centroid yet
+			chosen = 0;
+			while (chosen < num_of_candidates - 1 && Dc[chosen] == 0)
+				chosen++;
+		}
+
+		centroids[t]->set(dataset.get_ith_object(candidates[chosen]));
+
+		parallel_for(num_of_candidates, candidate_threads, [&](int begin, int end, int thread)
+		{
+			for (int c = begin; c < end; ++c)
+				Dc[c] = std::min(Dc[c], Strategy::bounded_distance(dataset.get_ith_object(candidates[c]), *centroids[t], Dc[c]));
+		});
+		Dc[chosen] = 0;
+	}
+}
 
 // clustering using exact lloyd's as assignment method
-void Cluster_info::exact_lloyds(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+int Cluster_info<Strategy>::nearest_centroid(const Abstract_Object & object) const
 {
-	bool converged = false;
+	double min_dist = Strategy::distance(object, *centroids[0]);
+	int cluster_index = 0;
 
-	while (!converged)
+	// a distance can be abandoned once it exceeds the nearest one found so far (curves stop their dynamic programming early)
+	for (int j = 1; j < K; ++j)
 	{
-		// clear previous clusters
-		for (int i = 0; i < K; ++i)
+		double dist = Strategy::bounded_distance(object, *centroids[j], min_dist);
+		if (dist < min_dist)
 		{
-			(this->clusters[i]).clear();
+			min_dist = dist;		// update min distance
+			cluster_index = j;		// update cluster index
 		}
 
-		int num_of_Objects = dataset.get_num_of_Objects();
+	}
 
-		// create new clusters by assigning each object to its exact nearest centroid
-		for (int i = 0; i < num_of_Objects; ++i)
-		{
-			const Abstract_Object * object = & dataset.get_ith_object(i);
-			double min_dist = (*metric)(*object, *centroids[0]);
-			int cluster_index = 0;
+	return cluster_index;
+}
 
-			for (int j = 1; j < K; ++j)
-			{
-				double dist = (*metric)(*object, *centroids[j]);
-				if (dist < min_dist)
-				{
-					min_dist = dist;		// update min distance
-					cluster_index = j;		// update cluster index
-				}
+template <typename Strategy>
+void Cluster_info<Strategy>::assign_to_nearest(const Dataset & dataset)
+{
+	// clear previous clusters
+	for (int i = 0; i < K; ++i)
+	{
+		(this->clusters[i]).clear();
+	}
 
-			}
+	int num_of_Objects = dataset.get_num_of_Objects();
+	this->assignment.resize(num_of_Objects);
+
+	// create new clusters by assigning each object to its exact nearest centroid
+	// each thread assigns a contiguous chunk of the objects into its own clusters, which are then appended in thread order
+	// (so every cluster holds its objects in dataset order, as if assigned by a single thread)
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	std::vector <std::vector <std::vector <const Abstract_Object*> > > partial_clusters(threads, std::vector <std::vector <const Abstract_Object*> >(K));
 
+	parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			const Abstract_Object * object = & dataset.get_ith_object(i);
 			// insert object to cluster of exact nearest centroid
-			(this->clusters[cluster_index]).push_back(object);
+			this->assignment[i] = nearest_centroid(*object);
+			partial_clusters[thread][this->assignment[i]].push_back(object);
 		}
+	});
+
+	for (int t = 0; t < threads; ++t)
+	{
+		for (int j = 0; j < K; ++j)
+			(this->clusters[j]).insert((this->clusters[j]).end(), partial_clusters[t][j].begin(), partial_clusters[t][j].end());
+	}
+}
+
+template <typename Strategy>
+void Cluster_info<Strategy>::exact_lloyds(const Dataset & dataset, const std::string & update_method)
+{
+	bool converged = false;
+
+	while (!converged)
+	{
+		// create new clusters by assigning each object to its exact nearest centroid
+		assign_to_nearest(dataset);
 
 		// update centroids and update converged value
-		converged = this->update(update_method, metric);
+		converged = this->update(dataset, update_method);
 	}
 
 }
 
-//A general way to compute the min and max
-template<typename T>
-T min(T x, T y){
-	return (x < y) ? x : y;
-}
+// mini-batch k-means : each iteration assigns a batch of objects sampled uniformly (with replacement) to their nearest centroids,
+// then moves each centroid towards the objects of the batch assigned to it, with learning rate 1 / (objects the centroid has absorbed so far)
+// so every centroid is the running mean of the batch objects it got
+template <typename Strategy>
+void Cluster_info<Strategy>::mini_batch_clustering(const Dataset & dataset)
+{
+	const int num_of_Objects = dataset.get_num_of_Objects();
+	const int batch_size = std::min(this->batch_size, num_of_Objects);
 
-template<typename T>
-T max(T x, T y){
-	return (x > y) ? x : y;
-}
+	std::vector <int> batch(batch_size);				// dataset indices of the objects of the batch
+	std::vector <int> batch_assigned(batch_size);		// nearest centroid of each object of the batch
+	std::vector <long long> absorbed(K, 0);				// batch objects each centroid has absorbed so far
 
-// clustering using lsh range search as assignment method
-void Cluster_info::lsh_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &)){
-	bool converged = false;
+	int threads = parallel_threads(batch_size, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
 
-	//No need for something complicated, just calculate the distances and make the necessary update, exact_lloyds does that
-	if (K == 1){
-		this->exact_lloyds(dataset, update_method, metric);
+	for (int iteration = 0; iteration < this->batch_iterations; ++iteration)
+	{
+		// the batch is drawn before the threads start, so the clustering depends only on the seed
+		for (int b = 0; b < batch_size; ++b)
+			batch[b] = this->generator.uniform_int(0, num_of_Objects - 1);
+
+		parallel_for(batch_size, threads, [&](int begin, int end, int thread)
+		{
+			for (int b = begin; b < end; ++b)
+				batch_assigned[b] = nearest_centroid(dataset.get_ith_object(batch[b]));
+		});
+
+		// centroids are moved in batch order (mini-batch is used with Mean Vector only, so centroids are Objects)
+		for (int b = 0; b < batch_size; ++b)
+		{
+			int c = batch_assigned[b];
+			double eta = 1.0 / ++absorbed[c];
+			Object * centroid = static_cast<Object *>(this->centroids[c]);
+			const Object & object = static_cast<const Object &>(dataset.get_ith_object(batch[b]));
+
+			for (int j = 0; j < d; ++j)
+				centroid->set_ith(j, centroid->get_ith(j) + eta * (object.get_ith(j) - centroid->get_ith(j)));
+		}
+	}
+
+	if (this->full_assignment)
+	{
+		// a final pass of exact assignment gives the complete clusters
+		assign_to_nearest(dataset);
 		return;
 	}
 
-	int num_of_Objects = dataset.get_num_of_Objects();
+	// otherwise the clusters hold the (distinct) objects of the last batch
+	for (int i = 0; i < K; ++i)
+		(this->clusters[i]).clear();
 
-	lsh_struct lsh (floor((double) num_of_Objects/16));
+	std::vector <bool> in_cluster(num_of_Objects, false);
+	for (int b = 0; b < batch_size; ++b)
+	{
+		if (in_cluster[batch[b]])
+			continue;
+		in_cluster[batch[b]] = true;
+		(this->clusters[batch_assigned[b]]).push_back(& dataset.get_ith_object(batch[b]));
+	}
+}
 
-	lsh.import_data(dataset);
+template <typename Strategy>
+void Cluster_info<Strategy>::centroid_separation(std::vector <double> & half_distances, std::vector <double> & half_separation)
+{
+	half_distances.assign(K * K, 0.0);
+	half_separation.assign(K, std::numeric_limits<double>::infinity());
 
-	
+	// the pairs of centroids (i < j) are split into contiguous chunks, each thread fills the distances of its pairs
+	std::vector <std::pair <int, int> > pairs;
+	pairs.reserve(K * (K - 1) / 2);
+	for (int i = 0; i < K; ++i)
+		for (int j = i + 1; j < K; ++j)
+			pairs.emplace_back(i, j);
 
-	while (!converged)
+	int num_of_pairs = pairs.size();
+	int threads = parallel_threads(num_of_pairs, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	parallel_for(num_of_pairs, threads, [&](int begin, int end, int thread)
 	{
-		// initialize a map which will contain all the points (their id is the key) aready visited and their closest centroid and the distance from that centroid
-		std::map <std::string, std::pair<double,int>> map;
-		std::map<std::string, std::pair<double, int>>::iterator it;
-
-		// clear previous clusters
-		for (int i = 0; i < K; ++i){
-			(this->clusters[i]).clear();
-		}
-		//Initialise R
-		int R = this->centroids[K-2]->euclidean_distance(*(this->centroids[K-1]));
-		for (int i = 0 ; i < K ; i++){
-			for (int j = i+1 ; j < K ; j++){
-				R = min(R, (int) this->centroids[i]->euclidean_distance(*(this->centroids[j])));
-			}
+		for (int p = begin; p < end; ++p)
+		{
+			int i = pairs[p].first, j = pairs[p].second;
+			double half = Strategy::distance(*centroids[i], *centroids[j]) / 2;
+			half_distances[i * K + j] = half_distances[j * K + i] = half;
 		}
-		R /= 2;
+	});
 
-		int R2 = 0;
+	for (int i = 0; i < K; ++i)
+		for (int j = 0; j < K; ++j)
+			if (j != i)
+				half_separation[i] = std::min(half_separation[i], half_distances[i * K + j]);
 
-		while(1){
+	this->distance_evaluations += num_of_pairs;
+}
 
-			//Used to check whether any centroid added a point to its cluster
-			//If the flag does not become true, it means that no new points are added so add the rest via Lloyd's method
-			bool flag = false;
+// Elkan's bounds : an upper bound of the distance of each object to its centroid, and a lower bound of its distance to every centroid
+// a centroid is skipped if the upper bound is below its lower bound, or below half its distance from the current centroid (triangle inequality)
+// ties are broken towards the smaller centroid index and the bounds only skip strictly further centroids, so clusters are those of exact lloyd's
+template <typename Strategy>
+void Cluster_info<Strategy>::elkan_clustering(const Dataset & dataset, const std::string & update_method)
+{
+	const int num_of_Objects = dataset.get_num_of_Objects();
+	std::vector <int> assigned(num_of_Objects);						// centroid of each object
+	std::vector <double> upper(num_of_Objects);						// upper bound of the distance of each object to its centroid
+	std::vector <double> lower((size_t) num_of_Objects * K);		// lower bound of the distance of each object to each centroid (row major)
+	std::vector <double> half_distances, half_separation;
 
-			//For each centroid use range search 
-			for (int i = 0 ; i < K ; i++){
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	bool first = true;
+	bool converged = false;
 
-				//Execute range search and for each item in the set check if it is already in the map (if so, check which centroid is currently the closest)
-				// otherwise it has been found just now so add it to the map and do flag = true
-				for (auto item : lsh.range_search(*(this->centroids[i]), R, metric, R2)){
-					double dist = std::get<0>(item);
-					const Abstract_Object* obj_p = std::get<1>(item);
-					std::string id = obj_p->get_name();
-					it = map.find(id);
+	while (!converged)
+	{
+		if (!first)
+			centroid_separation(half_distances, half_separation);
+
+		std::vector <long long> evaluations(threads, 0);
+
+		parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				const Abstract_Object * object = & dataset.get_ith_object(i);
+				double * object_lower = & lower[(size_t) i * K];
+
+				if (first)
+				{
+					// no bounds yet, every distance is evaluated as in exact lloyd's
+					double min_dist = std::numeric_limits<double>::infinity();
+					int cluster_index = 0;
+					for (int j = 0; j < K; ++j)
+					{
+						// an abandoned distance is a lower bound above min_dist (centroid j is not the nearest), exact distances are kept if abandoning gives weak bounds
+						double dist = Strategy::abandoned_bounds ? Strategy::bounded_distance(*object, *centroids[j], min_dist) : Strategy::distance(*object, *centroids[j]);
+						object_lower[j] = dist;
+						if (dist < min_dist)
+						{
+							min_dist = dist;
+							cluster_index = j;
+						}
+					}
+					evaluations[thread] += K;
+					assigned[i] = cluster_index;
+					upper[i] = min_dist;
+					continue;
+				}
+
+				int cluster_index = assigned[i];
+				double u = upper[i];
+				if (u * (1 + TRIANGLE_SLACK) < half_separation[cluster_index])
+					continue;		// every other centroid is further than the current one
 
-					//If the item has not been inserted yet then add it
-					// It also means that the currently closest centroid is the i-th one
-					// In the other case, it already is in the map but the distance of the object is closest to the i-th centroid so change the information
-					if (it == map.end()){
-						flag = true;
-						map[id] = std::make_pair(dist, i);
+				bool tight = false;		// true once u is the exact distance to the current centroid
+				for (int j = 0; j < K; ++j)
+				{
+					if (j == cluster_index || u * (1 + TRIANGLE_SLACK) < object_lower[j] || u * (1 + TRIANGLE_SLACK) < half_distances[cluster_index * K + j])
+						continue;
+
+					if (!tight)
+					{
+						u = Strategy::distance(*object, *centroids[cluster_index]);
+						object_lower[cluster_index] = u;
+						evaluations[thread]++;
+						tight = true;
+						if (u * (1 + TRIANGLE_SLACK) < object_lower[j] || u * (1 + TRIANGLE_SLACK) < half_distances[cluster_index * K + j])
+							continue;
 					}
-					else if (std::get<-0>(map[id]) > dist){
-						it->second.first = dist;
-						it->second.second = i;
+
+					// the distance is abandoned once it exceeds u, centroid j cannot be the nearest then
+					double dist = Strategy::abandoned_bounds ? Strategy::bounded_distance(*object, *centroids[j], u) : Strategy::distance(*object, *centroids[j]);
+					object_lower[j] = dist;
+					evaluations[thread]++;
+					if (dist < u || (dist == u && j < cluster_index))
+					{
+						u = dist;
+						cluster_index = j;
 					}
 				}
-			}
 
-			if (flag == false) break;
+				assigned[i] = cluster_index;
+				upper[i] = u;
+			}
+		});
+
+		long long object_evaluations = 0;
+		for (int t = 0; t < threads; ++t)
+			object_evaluations += evaluations[t];
+		this->distance_evaluations += object_evaluations;
+		this->lloyds_distances += (long long) num_of_Objects * K;
+		this->skipped_distances += (long long) num_of_Objects * K - object_evaluations;
+
+		// rebuild clusters in dataset order, as exact lloyd's does
+		for (int j = 0; j < K; ++j)
+			(this->clusters[j]).clear();
+		for (int i = 0; i < num_of_Objects; ++i)
+			(this->clusters[assigned[i]]).push_back(& dataset.get_ith_object(i));
+		this->assignment = assigned;
 
-			R2 = R;
-			R *= 2;
+		// update centroids and update converged value
+		converged = this->update(dataset, update_method);
+		first = false;
 
+		if (!converged)
+		{
+			// loosen the bounds by the distance each centroid moved
+			parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
+			{
+				for (int i = begin; i < end; ++i)
+				{
+					upper[i] += this->centroid_shifts[assigned[i]];
+					for (int j = 0; j < K; ++j)
+						lower[(size_t) i * K + j] = std::max(lower[(size_t) i * K + j] - this->centroid_shifts[j], 0.0);
+				}
+			});
 		}
+	}
+}
 
-		//Find the points which are already not assigned and run the exact_lloyds variant for them
-		// For every other point, since it is already in the map, we know which cluster is closest to it
-		// create new clusters by assigning each object to its exact nearest centroid
-		for (int i = 0; i < num_of_Objects; ++i)
+// Hamerly's bounds : an upper bound of the distance of each object to its centroid, and a single lower bound of its distance to any other centroid
+// an object keeps its centroid if the upper bound is below the lower bound or below half the distance of its centroid to the nearest other one,
+// otherwise all K distances are evaluated as in exact lloyd's (so the clusters are those of exact lloyd's)
+template <typename Strategy>
+void Cluster_info<Strategy>::hamerly_clustering(const Dataset & dataset, const std::string & update_method)
+{
+	const int num_of_Objects = dataset.get_num_of_Objects();
+	std::vector <int> assigned(num_of_Objects);			// centroid of each object
+	std::vector <double> upper(num_of_Objects);			// upper bound of the distance of each object to its centroid
+	std::vector <double> lower(num_of_Objects);			// lower bound of the distance of each object to every other centroid
+	std::vector <double> half_distances, half_separation(K, 0.0);
+
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	bool first = true;
+	bool converged = false;
+
+	while (!converged)
+	{
+		if (!first)
+			centroid_separation(half_distances, half_separation);
+
+		std::vector <long long> evaluations(threads, 0);
+
+		parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
 		{
-			const Abstract_Object * object = & dataset.get_ith_object(i);
+			for (int i = begin; i < end; ++i)
+			{
+				const Abstract_Object * object = & dataset.get_ith_object(i);
 
-			std::string id = object->get_name();
+				if (!first)
+				{
+					double bound = std::max(half_separation[assigned[i]], lower[i]);
+					if (upper[i] * (1 + TRIANGLE_SLACK) < bound)
+						continue;		// every other centroid is further than the current one
+
+					// tighten the upper bound and test again
+					upper[i] = Strategy::distance(*object, *centroids[assigned[i]]);
+					evaluations[thread]++;
+					if (upper[i] * (1 + TRIANGLE_SLACK) < bound)
+						continue;
+				}
 
-			it = map.find(id);
-			
-			//If the object is already in the map just see which centroid is closest to it
-			if (it != map.end()){
-				this->clusters[it->second.second].push_back(object);
-				continue;
+				// find the nearest and second nearest centroid (the distance to the current centroid is already known, unless on the first iteration)
+				double min_dist = std::numeric_limits<double>::infinity();
+				double second_dist = std::numeric_limits<double>::infinity();
+				int cluster_index = 0;
+				for (int j = 0; j < K; ++j)
+				{
+					double dist;
+					if (!first && j == assigned[i])
+						dist = upper[i];
+					else
+					{
+						// abandoned once it exceeds the second nearest distance, centroid j is then neither the nearest nor the second nearest
+						dist = Strategy::bounded_distance(*object, *centroids[j], second_dist);
+						evaluations[thread]++;
+					}
+
+					if (dist < min_dist)
+					{
+						second_dist = min_dist;
+						min_dist = dist;
+						cluster_index = j;
+					}
+					else if (dist < second_dist)
+						second_dist = dist;
+				}
+
+				assigned[i] = cluster_index;
+				upper[i] = min_dist;
+				lower[i] = second_dist;
 			}
+		});
+
+		long long object_evaluations = 0;
+		for (int t = 0; t < threads; ++t)
+			object_evaluations += evaluations[t];
+		this->distance_evaluations += object_evaluations;
+		this->lloyds_distances += (long long) num_of_Objects * K;
+		this->skipped_distances += (long long) num_of_Objects * K - object_evaluations;
+
+		// rebuild clusters in dataset order, as exact lloyd's does
+		for (int j = 0; j < K; ++j)
+			(this->clusters[j]).clear();
+		for (int i = 0; i < num_of_Objects; ++i)
+			(this->clusters[assigned[i]]).push_back(& dataset.get_ith_object(i));
+		this->assignment = assigned;
 
+		// update centroids and update converged value
+		converged = this->update(dataset, update_method);
+		first = false;
 
-			double min_dist = (*metric)(*object, *centroids[0]);
-			int cluster_index = 0;
+		if (!converged)
+		{
+			// the lower bound is loosened by the largest move of any other centroid (the largest and second largest moves are kept)
+			int max_index = 0;
+			double max_shift = 0.0, second_shift = 0.0;
+			for (int j = 0; j < K; ++j)
+			{
+				if (this->centroid_shifts[j] > max_shift)
+				{
+					second_shift = max_shift;
+					max_shift = this->centroid_shifts[j];
+					max_index = j;
+				}
+				else if (this->centroid_shifts[j] > second_shift)
+					second_shift = this->centroid_shifts[j];
+			}
 
-			for (int j = 1; j < K; ++j)
+			parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
 			{
-				double dist = (*metric)(*object, *centroids[j]);
-				if (dist < min_dist)
+				for (int i = begin; i < end; ++i)
 				{
-					min_dist = dist;		// update min distance
-					cluster_index = j;		// update cluster index
+					upper[i] += this->centroid_shifts[assigned[i]];
+					lower[i] -= (assigned[i] == max_index) ? second_shift : max_shift;
 				}
+			});
+		}
+	}
+}
 
-			}
+//A general way to compute the min and max
+template<typename T>
+T min(T x, T y){
+	return (x < y) ? x : y;
+}
 
-			// insert object to cluster of exact nearest centroid
-			(this->clusters[cluster_index]).push_back(object);
+template<typename T>
+T max(T x, T y){
+	return (x > y) ? x : y;
+}
+
+template <typename Strategy>
+void Cluster_info<Strategy>::range_assignment(const Dataset & dataset, std::vector <std::vector <std::pair <double, const Abstract_Object*> > > & candidates, int R)
+{
+	int num_of_Objects = dataset.get_num_of_Objects();
+
+	// clear previous clusters
+	for (int i = 0; i < K; ++i){
+		(this->clusters[i]).clear();
+	}
+
+	// dense arrays indexed by object id : the centroid each object is currently assigned to (-1 if not reached yet) and its distance from it
+	this->assignment.assign(num_of_Objects, -1);
+	std::vector <double> assigned_distance(num_of_Objects);
+
+	// the candidates of each centroid are sorted by distance, so that the range search of the ring [R/2, R)
+	// is just the candidates from next[i] up to the first one at distance R or more (each candidate is checked once, whatever the number of rounds)
+	for (int i = 0 ; i < K ; i++){
+		std::sort(candidates[i].begin(), candidates[i].end());
+	}
+	std::vector <size_t> next(K, 0);
+
+	while(1){
+
+		//Used to check whether any centroid added a point to its cluster
+		//If the flag does not become true, it means that no new points are added so add the rest via Lloyd's method
+		bool flag = false;
+
+		//For each centroid use range search 
+		for (int i = 0 ; i < K ; i++){
+
+			// for each candidate of the ring, check if it is already assigned (if so, check which centroid is currently the closest)
+			// otherwise it has been found just now so assign it and do flag = true
+			for (; next[i] < candidates[i].size() && candidates[i][next[i]].first < R; ++next[i]){
+				double dist = candidates[i][next[i]].first;
+				int id = candidates[i][next[i]].second->get_id();
+
+				if (this->assignment[id] == -1){
+					flag = true;
+					this->assignment[id] = i;
+					assigned_distance[id] = dist;
+				}
+				else if (assigned_distance[id] > dist){
+					this->assignment[id] = i;
+					assigned_distance[id] = dist;
+				}
+			}
 		}
 
+		if (flag == false) break;
+
+		R *= 2;
 
-		// update centroids and update converged value
-		converged = this->update(update_method, metric);	
 	}
 
+	// the objects not reached by any range search are assigned to their exact nearest centroid
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? ASSIGNMENT_CURVE_CHUNK : ASSIGNMENT_CHUNK);
+	parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
+	{
+		for (int i = begin; i < end; ++i)
+		{
+			if (this->assignment[i] == -1)
+				this->assignment[i] = this->nearest_centroid(dataset.get_ith_object(i));
+		}
+	});
+
+	// create new clusters, objects in dataset order
+	for (int i = 0; i < num_of_Objects; ++i)
+	{
+		this->clusters[this->assignment[i]].push_back(& dataset.get_ith_object(i));
+	}
 }
 
-// clustering using hypercube range search as assignment method
-void Cluster_info::cube_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &)){
+// clustering using lsh range search as assignment method
+template <typename Strategy>
+void Cluster_info<Strategy>::lsh_range_search_clustering(const Dataset & dataset, const std::string & update_method){
 	bool converged = false;
 
 	//No need for something complicated, just calculate the distances and make the necessary update, exact_lloyds does that
 	if (K == 1){
-		this->exact_lloyds(dataset, update_method, metric);
+		this->exact_lloyds(dataset, update_method);
 		return;
 	}
 
 	int num_of_Objects = dataset.get_num_of_Objects();
 
-	hypercube cube;
+	lsh_struct<vector_strategy> lsh (global_index_params(), floor((double) num_of_Objects/16), this->generator);
 
-	cube.import_data(dataset);
+	lsh.import_data(dataset);
 
 	
 
 	while (!converged)
 	{
-		// initialize a map which will contain all the points (their id is the key) aready visited and their closest centroid and the distance from that centroid
-		std::map <std::string, std::pair<double,int>> map;
-		std::map<std::string, std::pair<double, int>>::iterator it;
-
-		// clear previous clusters
-		for (int i = 0; i < K; ++i){
-			(this->clusters[i]).clear();
-		}
 		//Initialise R
 		int R = this->centroids[K-2]->euclidean_distance(*(this->centroids[K-1]));
 		for (int i = 0 ; i < K ; i++){
@@ -486,102 +948,83 @@ void Cluster_info::cube_range_search_clustering(const Dataset & dataset, const s
 		}
 		R /= 2;
 
-		int R2 = 0;
-
-		while(1){
-
-			//Used to check whether any centroid added a point to its cluster
-			//If the flag does not become true, it means that no new points are added so add the rest via Lloyd's method
-			bool flag = false;
-
-			//For each centroid use range search 
-			for (int i = 0 ; i < K ; i++){
-
-				//Execute range search and for each item in the set check if it is already in the map (if so, check which centroid is currently the closest)
-				// otherwise it has been found just now so add it to the map and do flag = true
-				for (auto item : cube.range_search(*(this->centroids[i]), R, metric, R2)){
-					double dist = std::get<0>(item);
-					const Abstract_Object* obj_p = std::get<1>(item);
-					std::string id = obj_p->get_name();
-					it = map.find(id);
-
-					//If the item has not been inserted yet then add it
-					// It also means that the currently closest centroid is the i-th one
-					// In the other case, it already is in the map but the distance of the object is closest to the i-th centroid so change the information
-					if (it == map.end()){
-						flag = true;
-						map[id] = std::make_pair(dist, i);
-					}
-					else if (std::get<-0>(map[id]) > dist){
-						it->second.first = dist;
-						it->second.second = i;
-					}
-				}
+		// the buckets of a centroid do not depend on the radius, so its candidates and their distances are found once per iteration
+		std::vector <std::vector <std::pair <double, const Abstract_Object*> > > candidates(K);
+		parallel_for(K, parallel_threads(K, 1), [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				for (const Abstract_Object * object : lsh.bucket_objects(*(this->centroids[i])))
+					candidates[i].emplace_back(vector_strategy::distance(*(this->centroids[i]), *object), object);
 			}
+		});
 
-			if (flag == false) break;
+		this->range_assignment(dataset, candidates, R);
 
-			R2 = R;
-			R *= 2;
-
-		}
+		// update centroids and update converged value
+		converged = this->update(dataset, update_method);	
+	}
 
-		//Find the points which are already not assigned and run the exact_lloyds variant for them
-		// For every other point, since it is already in the map, we know which cluster is closest to it
-		// create new clusters by assigning each object to its exact nearest centroid
-		for (int i = 0; i < num_of_Objects; ++i)
-		{
-			const Abstract_Object * object = & dataset.get_ith_object(i);
+}
 
-			std::string id = object->get_name();
+// clustering using hypercube range search as assignment method
+template <typename Strategy>
+void Cluster_info<Strategy>::cube_range_search_clustering(const Dataset & dataset, const std::string & update_method){
+	bool converged = false;
 
-			it = map.find(id);
-			
-			//If the object is already in the map just see which centroid is closest to it
-			if (it != map.end()){
-				this->clusters[it->second.second].push_back(object);
-				continue;
-			}
+	//No need for something complicated, just calculate the distances and make the necessary update, exact_lloyds does that
+	if (K == 1){
+		this->exact_lloyds(dataset, update_method);
+		return;
+	}
 
+	hypercube<vector_strategy> cube(global_index_params(), this->generator);
 
-			double min_dist = (*metric)(*object, *centroids[0]);
-			int cluster_index = 0;
+	cube.import_data(dataset);
 
-			for (int j = 1; j < K; ++j)
-			{
-				double dist = (*metric)(*object, *centroids[j]);
-				if (dist < min_dist)
-				{
-					min_dist = dist;		// update min distance
-					cluster_index = j;		// update cluster index
-				}
+	
 
+	while (!converged)
+	{
+		//Initialise R
+		int R = this->centroids[K-2]->euclidean_distance(*(this->centroids[K-1]));
+		for (int i = 0 ; i < K ; i++){
+			for (int j = i+1 ; j < K ; j++){
+				R = min(R, (int) this->centroids[i]->euclidean_distance(*(this->centroids[j])));
 			}
-
-			// insert object to cluster of exact nearest centroid
-			(this->clusters[cluster_index]).push_back(object);
 		}
+		R /= 2;
+
+		// the vertices probed for a centroid do not depend on the radius, so its candidates and their distances are found once per iteration
+		std::vector <std::vector <std::pair <double, const Abstract_Object*> > > candidates(K);
+		parallel_for(K, parallel_threads(K, 1), [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+				candidates[i] = cube.probed_objects(*(this->centroids[i]));
+		});
 
+		this->range_assignment(dataset, candidates, R);
 
 		// update centroids and update converged value
-		converged = this->update(update_method, metric);	
+		converged = this->update(dataset, update_method);	
 	}
 }
 
 // clustering using frechet range search as assignment method
-void Cluster_info::frechet_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+void Cluster_info<Strategy>::frechet_range_search_clustering(const Dataset & dataset, const std::string & update_method)
 {
 	bool converged = false;
 
 	//No need for something complicated, just calculate the distances and make the necessary update, exact_lloyds does that
 	if (K == 1){
-		this->exact_lloyds(dataset, update_method, metric);
+		this->exact_lloyds(dataset, update_method);
 		return;
 	}
 
 	int num_of_Objects = dataset.get_num_of_Objects();
 
-	lsh_struct lsh_frechet (floor((double) num_of_Objects/16));
+	lsh_struct<discrete_frechet_strategy> lsh_frechet (global_index_params(), floor((double) num_of_Objects/16), this->generator);
 
 	lsh_frechet.import_data(dataset);
 
@@ -589,106 +1032,122 @@ void Cluster_info::frechet_range_search_clustering(const Dataset & dataset, cons
 
 	while (!converged)
 	{
-		// initialize a map which will contain all the points (their id is the key) aready visited and their closest centroid and the distance from that centroid
-		std::map <std::string, std::pair<double,int>> map;
-		std::map<std::string, std::pair<double, int>>::iterator it;
-
-		// clear previous clusters
-		for (int i = 0; i < K; ++i){
-			(this->clusters[i]).clear();
-		}
 		//Initialise R
-		int R = metric(*this->centroids[K-2],*(this->centroids[K-1]));
+		int R = Strategy::distance(*this->centroids[K-2],*(this->centroids[K-1]));
 		for (int i = 0 ; i < K ; i++){
 			for (int j = i+1 ; j < K ; j++){
-				R = min(R, (int) metric(*this->centroids[i],*(this->centroids[j])));
+				R = min(R, (int) Strategy::distance(*this->centroids[i],*(this->centroids[j])));
 			}
 		}
 		R /= 2;
 
-		std::set<std::string> visited_set;
-
-		while(1){
-
-			//Used to check whether any centroid added a point to its cluster
-			//If the flag does not become true, it means that no new points are added so add the rest via Lloyd's method
-			bool flag = false;
-
-			//For each centroid use range search 
-			for (int i = 0 ; i < K ; i++){
-
-				//Execute range search and for each item in the set check if it is already in the map (if so, check which centroid is currently the closest)
-				// otherwise it has been found just now so add it to the map and do flag = true
-				for (auto item : lsh_frechet.range_search_with_set(*(this->centroids[i]), R, visited_set, metric)){
-					double dist = std::get<0>(item);
-					const Abstract_Object* obj_p = std::get<1>(item);
-					std::string id = obj_p->get_name();
-					it = map.find(id);
-
-					//If the item has not been inserted yet then add it
-					// It also means that the currently closest centroid is the i-th one
-					// In the other case, it already is in the map but the distance of the object is closest to the i-th centroid so change the information
-					if (it == map.end()){
-						flag = true;
-						map[id] = std::make_pair(dist, i);
-					}
-					else if (std::get<-0>(map[id]) > dist){
-						it->second.first = dist;
-						it->second.second = i;
-					}
+		// the buckets of each centroid are found once per iteration
+		std::vector <std::vector <const Abstract_Object*> > bucket_objects(K);
+		parallel_for(K, parallel_threads(K, 1), [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+				bucket_objects[i] = lsh_frechet.bucket_objects(*(this->centroids[i]));
+		});
+
+		// every object is checked once, by the first centroid whose buckets hold it, and kept only if it is within R
+		// (so a larger radius finds no new objects, the objects left are assigned to their nearest centroid)
+		std::vector <char> visited(num_of_Objects, 0);
+		std::vector <std::vector <std::pair <double, const Abstract_Object*> > > candidates(K);
+		for (int i = 0 ; i < K ; i++){
+			for (const Abstract_Object * object : bucket_objects[i]){
+				if (visited[object->get_id()] == 0){
+					visited[object->get_id()] = 1;
+					candidates[i].emplace_back(0.0, object);
 				}
 			}
+		}
 
-			if (flag == false) break;
+		parallel_for(K, parallel_threads(K, 1), [&](int begin, int end, int thread)
+		{
+			for (int i = begin; i < end; ++i)
+			{
+				for (auto & candidate : candidates[i])
+					candidate.first = discrete_frechet_strategy::distance(*(this->centroids[i]), *candidate.second);
+				candidates[i].erase(std::remove_if(candidates[i].begin(), candidates[i].end(),
+					[R](const std::pair <double, const Abstract_Object*> & candidate) { return candidate.first >= R; }), candidates[i].end());
+			}
+		});
 
-			R *= 2;
+		this->range_assignment(dataset, candidates, R);
 
-		}
+		// update centroids and update converged value
+		converged = this->update(dataset, update_method);	
+	}
+}
 
-		//Find the points which are already not assigned and run the exact_lloyds variant for them
-		// For every other point, since it is already in the map, we know which cluster is closest to it
-		// create new clusters by assigning each object to its exact nearest centroid
-		for (int i = 0; i < num_of_Objects; ++i)
-		{
-			const Abstract_Object * object = & dataset.get_ith_object(i);
 
-			std::string id = object->get_name();
+template <typename Strategy>
+void Cluster_info<Strategy>::vector_means(const Dataset & dataset, std::vector <const Abstract_Object*> & cluster_means)
+{
+	const int num_of_Objects = dataset.get_num_of_Objects();
 
-			it = map.find(id);
-			
-			//If the object is already in the map just see which centroid is closest to it
-			if (it != map.end()){
-				this->clusters[it->second.second].push_back(object);
-				continue;
-			}
+	// first update : no object is counted in the sums yet
+	if ((int) this->summed_cluster.size() != num_of_Objects)
+	{
+		this->summed_cluster.assign(num_of_Objects, -1);
+		this->coordinate_sums.assign(K, std::vector <double>(d, 0.0));
+		this->cluster_counts.assign(K, 0);
+	}
 
+	// objects whose cluster changed since the sums were last updated
+	std::vector <int> moved;
+	for (int i = 0; i < num_of_Objects; ++i)
+	{
+		if (this->assignment[i] != this->summed_cluster[i])
+			moved.push_back(i);
+	}
 
-			double min_dist = (*metric)(*object, *centroids[0]);
-			int cluster_index = 0;
+	// each thread moves the objects into and out of its own range of clusters, and computes their means
+	// (so each sum is updated by a single thread, in object order)
+	parallel_for(K, parallel_threads(K, 1), [&](int begin, int end, int thread)
+	{
+		for (int i : moved)
+		{
+			const Object & object = static_cast<const Object &>(dataset.get_ith_object(i));		// Mean Vector is used only for Objects
+			int from = this->summed_cluster[i];
+			int to = this->assignment[i];
 
-			for (int j = 1; j < K; ++j)
+			if (from >= begin && from < end)
 			{
-				double dist = (*metric)(*object, *centroids[j]);
-				if (dist < min_dist)
-				{
-					min_dist = dist;		// update min distance
-					cluster_index = j;		// update cluster index
-				}
+				for (int j = 0; j < d; ++j)
+					this->coordinate_sums[from][j] -= object.get_ith(j);
+				this->cluster_counts[from]--;
+			}
+			if (to >= begin && to < end)
+			{
+				for (int j = 0; j < d; ++j)
+					this->coordinate_sums[to][j] += object.get_ith(j);
+				this->cluster_counts[to]++;
+			}
+		}
 
+		for (int c = begin; c < end; ++c)
+		{
+			// empty cluster has no mean
+			if (this->cluster_counts[c] == 0)
+			{
+				cluster_means[c] = nullptr;
+				continue;
 			}
 
-			// insert object to cluster of exact nearest centroid
-			(this->clusters[cluster_index]).push_back(object);
+			std::vector <float> mean_vector(d);
+			for (int j = 0; j < d; ++j)
+				mean_vector[j] = this->coordinate_sums[c][j] / this->cluster_counts[c];
+			cluster_means[c] = new Object(mean_vector);
 		}
+	});
 
-
-		// update centroids and update converged value
-		converged = this->update(update_method, metric);	
-	}
+	for (int i : moved)
+		this->summed_cluster[i] = this->assignment[i];
 }
 
-
-bool Cluster_info::update(const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+bool Cluster_info<Strategy>::update(const Dataset & dataset, const std::string & update_method)
 {
 	double e_euclid = 1;			// testing required
 	double e_frechet = 20;			// testing required
@@ -696,18 +1155,31 @@ bool Cluster_info::update(const std::string & update_method, double (*metric)(co
 	int max_iters = 12;
 	static int iters = 0;
 
+	// compute the mean of each cluster
+	std::vector <const Abstract_Object*> cluster_means(K);
+
+	if (update_method == "Mean Vector")
+		vector_means(dataset, cluster_means);		// from the running sums, only objects that changed cluster cost O(d)
+	else
+	{
+		// clusters are reduced one at a time, each reduction merges the curves of a level of its tree in parallel
+		for (int i = 0; i < K; ++i)
+			cluster_means[i] = mean(this->clusters[i], this->generator);
+	}
+
 	// for each cluster
 	for (int i = 0; i < K; ++i)
 	{
-		// compute mean of cluster
-		const Abstract_Object * cluster_mean = mean(update_method, this->clusters[i]);
+		const Abstract_Object * cluster_mean = cluster_means[i];
+		this->centroid_shifts[i] = 0.0;
 
 		// if cluster is empty, mean is null, just continue, avg_deviation, centroid remain unchanged
 		if (cluster_mean == nullptr)
 			continue;
 		
-		// calculate average change across all centroids
-		avg_deviation += (*metric)(*cluster_mean, *(this->centroids[i])) / K;
+		// calculate average change across all centroids (the move of each centroid is kept for the bounds of Elkan and Hamerly)
+		this->centroid_shifts[i] = Strategy::distance(*cluster_mean, *(this->centroids[i]));
+		avg_deviation += this->centroid_shifts[i] / K;
 		
 		// set new centroid of cluster to be the cluster_mean
 		(this->centroids[i])->set(*cluster_mean);
@@ -731,46 +1203,24 @@ bool Cluster_info::update(const std::string & update_method, double (*metric)(co
 	
 }
 
-Abstract_Object * mean(const std::string & update_method, const std::vector <const Abstract_Object*> & cluster)
+Abstract_Object * mean(const std::vector <const Abstract_Object*> & cluster, rng & generator)
 {
 	// check for empty cluster
 	if (cluster.size() == 0)
 		return nullptr;
 	
-	// continue, cluster not empty ==> mean curve/vector are defined
-
-	if (update_method == "Mean Frechet")	// Mean Curve is used
-	{
-		// create a complete binary tree with curves of cluster as leafs
-		CBTree CBT(cluster);
-		// traverse complete binary tree in post order fashion, to find the mean curve in root, and return it
-		return CBT.post_order_traversal();
-	}
-	else	// Mean Vector is used
-	{
-		std::vector <float> mean_vector(d, 0.0);
-		int T = cluster.size();		// get number of objects in cluster
-
-		// for each object in cluster
-		for (auto const& abstract_object : cluster)
-		{
-			const Object* object  = dynamic_cast<const Object *>(abstract_object);
-			for (int j = 0; j < d; j++)
-			{
-				// update mean vector
-				mean_vector[j] += object->get_ith(j) / T;
-			}
-			
-		}
+	// continue, cluster not empty ==> mean curve is defined
 
-		// create and return the mean vector Object
-		return new Object(mean_vector);
-	}
+	// create a complete binary tree with curves of cluster as leafs
+	CBTree CBT(cluster);
+	// reduce complete binary tree bottom up, to find the mean curve in root, and return it
+	return CBT.reduce(generator);
 }
 
 
 // finds silhouette for each cluster, and for clustering in total
-std::vector <double> Cluster_info::silhouette(double (*metric)(const Abstract_Object &, const Abstract_Object &)) const{
+template <typename Strategy>
+std::vector <double> Cluster_info<Strategy>::silhouette() const{
 	
 	double s_total = 0;
 
@@ -796,7 +1246,7 @@ std::vector <double> Cluster_info::silhouette(double (*metric)(const Abstract_Ob
 			for (int k = 0 ; k < cl_size ; k++){
 				if (j == k) continue;
 
-				a_i += (*metric)(*obj_p, *(this->clusters[i][k]));
+				a_i += Strategy::distance(*obj_p, *(this->clusters[i][k]));
 			}
 			if (cl_size != 1)
 				a_i /= cl_size -1;
@@ -807,7 +1257,7 @@ std::vector <double> Cluster_info::silhouette(double (*metric)(const Abstract_Ob
 			for (int k = 0; k < K; ++k)
 			{
 				if (k == i) continue;
-				double dist = (*metric)(*obj_p, *centroids[k]);
+				double dist = Strategy::distance(*obj_p, *centroids[k]);
 				if (dist < min_dist)
 				{
 					min_dist = dist;		// update min distance
@@ -820,7 +1270,7 @@ std::vector <double> Cluster_info::silhouette(double (*metric)(const Abstract_Ob
 
 			for (int k = 0 ; k < b_cl_size ; k++){
 
-				b_i += (*metric)(*obj_p, *(this->clusters[cluster_index][k]));
+				b_i += Strategy::distance(*obj_p, *(this->clusters[cluster_index][k]));
 			}
 			if (b_cl_size != 0)
 				b_i /= b_cl_size;
@@ -845,4 +1295,8 @@ std::vector <double> Cluster_info::silhouette(double (*metric)(const Abstract_Ob
 	}
 	silhouette.push_back(s_total/ total_size);
 	return silhouette;
-}		
\ No newline at end of file
+}
+
+// clustering is compiled once for vectors and once for time series
+template class Cluster_info<vector_strategy>;
+template class Cluster_info<discrete_frechet_strategy>;
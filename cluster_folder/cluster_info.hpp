@@ -6,47 +6,108 @@
 #include <vector>
 #include "object.hpp"
 #include "dataset.hpp"
+#include "rng.hpp"
+#include "strategies.hpp"
+
+// least number of objects assigned by each thread of the exact lloyd's assignment (euclidean distances are cheap, so vectors need large chunks)
+#define ASSIGNMENT_CHUNK 1024
+#define ASSIGNMENT_CURVE_CHUNK 8
+
+// bounds of the triangle inequality assignments are compared with this relative slack, so that rounding errors of the distances
+// never skip a centroid that exact lloyd's would pick (the clusters stay identical to exact lloyd's)
+#define TRIANGLE_SLACK 1e-6
+
+// default batch size and number of iterations of mini-batch k-means
+#define MINI_BATCH_SIZE 1024
+#define MINI_BATCH_ITERATIONS 100
+
+// rounds of k-means|| initialization, and default number of candidates sampled per round (as a multiple of K)
+#define KMEANS_PARALLEL_ROUNDS 5
+#define KMEANS_PARALLEL_OVERSAMPLING 0.5
 
 // class Cluster_info holds info for clustering
 // i.e. the centroids and the clusters
+// Strategy (see strategies.hpp) defines the type of the centroids and the metric used to compare objects to them
 
+template <typename Strategy>
 class Cluster_info
 {
 private:
 	std::vector <Abstract_Object*> centroids;						// a vector of centroids
 	std::vector <std::vector <const Abstract_Object*> > clusters; 	// a vector of vectors, i.e a vector of clusters
+	rng & generator;												// random generator for centroid initialization and for the hash functions of the assignment structures
+	std::vector <double> centroid_shifts;							// distance each centroid moved by in the last update (0 for empty clusters)
+	long long distance_evaluations;									// distances evaluated by the triangle inequality assignments (Elkan, Hamerly)
+	long long lloyds_distances;										// object to centroid distances exact lloyd's evaluates for the same iterations
+	long long skipped_distances;									// the ones of them skipped by the bounds
+
+	int batch_size;													// objects sampled in each iteration of mini-batch k-means
+	int batch_iterations;											// iterations of mini-batch k-means
+	bool full_assignment;											// true if mini-batch k-means ends with an exact assignment of all objects
+	std::vector <int> assignment;									// cluster of each object of the dataset, in the last assignment
+	std::vector <int> summed_cluster;								// cluster each object is counted in, by the coordinate sums (-1 for none)
+	std::vector <std::vector <double> > coordinate_sums;			// sum of the coordinates of the objects of each cluster (Mean Vector)
+	std::vector <int> cluster_counts;								// number of objects of each cluster, counted in the sums
+	std::string init_method;										// KMeans++ or KMeansParallel (k-means||)
+	double oversampling;											// candidates sampled per round of k-means||, as a multiple of K
+
+	// returns the index of the exact nearest centroid of given object
+	int nearest_centroid(const Abstract_Object & object) const;
+	// rebuilds the clusters by assigning every object of the dataset to its exact nearest centroid
+	void assign_to_nearest(const Dataset & dataset);
+	// computes the mean vector of each cluster (nullptr if empty) from running coordinate sums,
+	// moving only the objects whose cluster changed since the last update into and out of the sums
+	void vector_means(const Dataset & dataset, std::vector <const Abstract_Object*> & cluster_means);
+	// assigns every object to a centroid through range searches of each centroid, with a radius starting at R and doubled while new objects are found
+	// candidates[i] are the objects (with their distances) a range search of centroid i checks, the objects no range search reaches go to their nearest centroid
+	void range_assignment(const Dataset & dataset, std::vector <std::vector <std::pair <double, const Abstract_Object*> > > & candidates, int R);
+	// computes half the distance between every pair of centroids (K x K, row major) and half the distance of each centroid to its nearest other centroid
+	void centroid_separation(std::vector <double> & half_distances, std::vector <double> & half_separation);
 	
 
 public:
-	Cluster_info();
+	Cluster_info(rng & generator);
 	~Cluster_info();
 
-	// executes clustering using given metric function (pointer to function) and update method and assignment method
+	// sets the batch size and number of iterations of mini-batch k-means (0 keeps the default), and whether it ends with an exact assignment of all objects
+	void set_mini_batch(int batch_size, int batch_iterations, bool full_assignment);
+	// sets the initialization method (KMeans++ or KMeansParallel) and the oversampling of k-means|| (0 keeps the default)
+	void set_init(const std::string & init_method, double oversampling);
+
+	// executes clustering using given update method and assignment method
 	// and outputs results and execution times in output file
-	bool execute(const Dataset & dataset, const std::string & output_file, const std::string & update_method, const std::string & assignment_method, bool complete, bool run_silhouette, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	bool execute(const Dataset & dataset, const std::string & output_file, const std::string & update_method, const std::string & assignment_method, bool complete, bool run_silhouette);
 	
-	// uses the dataset given, to run K-means++ initialization and find K initial centroids
-	void K_means_init(const Dataset & dataset, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	// uses the dataset given, to run K-means++ initialization and find K initial centroids (random choices are drawn from given generator)
+	void K_means_init(const Dataset & dataset, rng & generator);
+	// same, using k-means|| : a few rounds oversample candidates, then K-means++ picks the K centroids among the weighted candidates
+	void K_means_parallel_init(const Dataset & dataset, rng & generator);
 
 	// clustering using exact lloyd's as assignment method
-	void exact_lloyds(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	void exact_lloyds(const Dataset & dataset, const std::string & update_method);
+	// clustering using exact lloyd's, skipping the distances that Elkan's bounds (one lower bound per object and centroid) rule out
+	void elkan_clustering(const Dataset & dataset, const std::string & update_method);
+	// clustering using exact lloyd's, skipping the distances that Hamerly's bounds (one lower bound per object) rule out
+	void hamerly_clustering(const Dataset & dataset, const std::string & update_method);
+	// clustering using mini-batch k-means (centroids are updated from sampled batches, not through update)
+	void mini_batch_clustering(const Dataset & dataset);
 	// clustering using lsh range search as assignment method
-	void lsh_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	void lsh_range_search_clustering(const Dataset & dataset, const std::string & update_method);
 	// clustering using hypercube range search as assignment method
-	void cube_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	void cube_range_search_clustering(const Dataset & dataset, const std::string & update_method);
 	// clustering using frechet range search as assignment method
-	void frechet_range_search_clustering(const Dataset & dataset, const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	void frechet_range_search_clustering(const Dataset & dataset, const std::string & update_method);
 	
 	// updates each centroid to the mean vector/curve of its cluster, and returns true if centroids changed by little (algorithm has converged)
-	bool update(const std::string & update_method, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	bool update(const Dataset & dataset, const std::string & update_method);
 	
 	// finds silhouette for each cluster, and for clustering in total
-	std::vector <double> silhouette(double (*metric)(const Abstract_Object &, const Abstract_Object &)) const;
+	std::vector <double> silhouette() const;
 	
 	
 };
 
-// returns mean vector or mean curve of given cluster of objects
-Abstract_Object * mean(const std::string & update_method, const std::vector <const Abstract_Object*> & cluster);
-int binary_search(const std::vector <float> & P, float x, int lower_index, int upper_index);
+// returns mean curve of given cluster of curves, nullptr if empty (the random choices are drawn from given generator)
+// (mean vectors are computed by Cluster_info::vector_means, from running coordinate sums)
+Abstract_Object * mean(const std::vector <const Abstract_Object*> & cluster, rng & generator);
 #endif
\ No newline at end of file
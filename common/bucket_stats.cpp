@@ -0,0 +1,37 @@
+//file:bucket_stats.cpp//
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "bucket_stats.hpp"
+
+bucket_stats get_bucket_stats(std::vector <int> & sizes)
+{
+	bucket_stats stats = {(int) sizes.size(), 0, 0, 0.0, 0, 0.0};
+
+	if (sizes.empty())
+		return stats;
+
+	std::sort(sizes.begin(), sizes.end());
+
+	int empty = 0;
+	for (int size : sizes)
+	{
+		stats.entries += size;
+		if (size == 0)
+			empty++;
+	}
+
+	stats.max_size = sizes.back();
+	stats.mean_size = (double) stats.entries / stats.buckets;
+	stats.p99_size = sizes[(size_t) (0.99 * (sizes.size() - 1))];
+	stats.empty_fraction = (double) empty / stats.buckets;
+
+	return stats;
+}
+
+void print_bucket_stats(std::ostream & out, const std::string & label, const bucket_stats & stats)
+{
+	out << label << stats.buckets << " buckets, " << stats.entries << " entries, bucket size max " << stats.max_size
+		<< " / mean " << stats.mean_size << " / p99 " << stats.p99_size << ", " << 100.0 * stats.empty_fraction << "% empty\n";
+}
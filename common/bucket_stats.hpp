@@ -0,0 +1,26 @@
+//file:bucket_stats.hpp//
+#ifndef _BUCKET_STATS_HPP_
+#define _BUCKET_STATS_HPP_
+#include <iostream>
+#include <string>
+#include <vector>
+
+// occupancy statistics of the buckets of a hash table (or the vertices of a hypercube)
+// a query scans a whole bucket, so the largest buckets are what the slowest queries pay for
+struct bucket_stats
+{
+	int buckets;				// number of buckets
+	int entries;				// number of entries in all buckets
+	int max_size;				// entries of the largest bucket
+	double mean_size;			// entries per bucket
+	int p99_size;				// 99% of the buckets have at most this many entries
+	double empty_fraction;		// fraction of the buckets with no entries
+};
+
+// returns the statistics of buckets with given sizes (sizes is sorted in place)
+bucket_stats get_bucket_stats(std::vector <int> & sizes);
+
+// prints given statistics in a single line, after given label
+void print_bucket_stats(std::ostream & out, const std::string & label, const bucket_stats & stats);
+
+#endif
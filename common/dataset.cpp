@@ -11,10 +11,8 @@
 
 
 
-Dataset::Dataset(int num_of_Points, std::string & input_file) : num_of_Objects(num_of_Points)
+Dataset::Dataset(int num_of_Points, std::string & input_file) : dataset(num_of_Points), removed(num_of_Points, false), num_of_Objects(num_of_Points)
 {
-	// create dataset array
-	dataset = new Abstract_Object*[num_of_Points];
 
 	// we use C code to read file because its faster than C++ and given input files are massive
 	char * line = NULL;
@@ -34,6 +32,7 @@ Dataset::Dataset(int num_of_Points, std::string & input_file) : num_of_Objects(n
 	else    /*following block of code reads from the file and inserts the data in the dataset array*/
 	{
 		int point_index = -1;
+		object_type type = current_object_type();		// same type for all objects of the file
 
 		while(getline(&line, &length, file_ptr) != -1)		// while loop will run for exaclty num_of_Objects times
 		{
@@ -63,33 +62,49 @@ Dataset::Dataset(int num_of_Points, std::string & input_file) : num_of_Objects(n
 		    }
 
 		    // different Abstract_Object depending on algorithm
-		    if (algorithm == "LSH" || algorithm == "Hypercube")
-		    {
-		    	dataset[point_index] = new Object(input_data, object_name);		 // create Abstract Object of type Object
-		    }
-		    else if (algorithm == "Frechet" && metric_func == "discrete")
-		    {
-		    	dataset[point_index] = new time_series(input_data, object_name); // create Abstract Object of type time_series
-		    }
-		    else if (algorithm == "Frechet" && metric_func == "continuous")
-		    {	
+		    dataset[point_index] = create_object(type, input_data, object_name);
+		    dataset[point_index]->set_id(point_index);		// object id is its index in dataset
+		    name_index[object_name] = point_index;
+		}
 
-				std::vector<float> filtered_curve = filter_input_curve(input_data); // Filter the curve
+		free(line);
+	}
 
-		    	dataset[point_index] = new Object(filtered_curve, object_name);		 // create Abstract Object of type Object (flattened time_series)
-		    }
-		    else
-		    {
-		    	dataset[point_index] = new Object(input_data, object_name);		 // default : create Abstract Object of type Object
-		    }
+	fclose(file_ptr);
+}
+
+object_type Dataset::current_object_type()
+{
+	// different Abstract_Object depending on algorithm (curves are searched with Frechet or Hypercube, given a metric)
+	bool curves = (algorithm == "Frechet" || algorithm == "Hypercube");
+	if (curves && metric_func == "discrete")
+		return TIME_SERIES_OBJECT;
+	else if (curves && metric_func == "continuous")
+		return FILTERED_CURVE_OBJECT;
+	else
+		return VECTOR_OBJECT;			// LSH, Hypercube, and default
+}
 
+Abstract_Object * Dataset::create_object(object_type type, std::vector <float> & input_data, std::string & object_name)
+{
+	switch (type)
+	{
+		case TIME_SERIES_OBJECT:
+			return new time_series(input_data, object_name); // create Abstract Object of type time_series
+		case FILTERED_CURVE_OBJECT:
+		{
+			std::vector<float> filtered_curve = filter_input_curve(input_data); // Filter the curve
 
+			return new Object(filtered_curve, object_name);		 // create Abstract Object of type Object (flattened time_series)
 		}
-
-		free(line);
+		default:
+			return new Object(input_data, object_name);		 // create Abstract Object of type Object
 	}
+}
 
-	fclose(file_ptr);
+Abstract_Object * Dataset::create_object(std::vector <float> & input_data, std::string & object_name)
+{
+	return create_object(current_object_type(), input_data, object_name);
 }
 
 Dataset::~Dataset()
@@ -98,8 +113,6 @@ Dataset::~Dataset()
 	{
 		delete dataset[i];
 	}
-
-	delete[] dataset;
 }
 
 void Dataset::print() const
@@ -119,4 +132,73 @@ int Dataset::get_num_of_Objects() const
 const Abstract_Object& Dataset::get_ith_object(int i) const
 {
 	return *(this->dataset[i]);
+}
+
+bool Dataset::is_removed(int i) const
+{
+	return this->removed[i];
+}
+
+int Dataset::find(const std::string & object_name) const
+{
+	std::unordered_map <std::string, int>::const_iterator it = this->name_index.find(object_name);
+
+	if (it == this->name_index.end())
+		return -1;
+
+	return it->second;
+}
+
+int Dataset::insert(Abstract_Object * object)
+{
+	int id = this->num_of_Objects++;
+
+	object->set_id(id);		// object id is its index in dataset
+	this->dataset.push_back(object);
+	this->removed.push_back(false);
+	this->name_index[object->get_name()] = id;
+
+	return id;
+}
+
+void Dataset::remove(int i)
+{
+	if (this->removed[i])
+		return;
+
+	this->removed[i] = true;
+
+	// name now refers to no object, unless it was already reused by a newer object
+	std::unordered_map <std::string, int>::iterator it = this->name_index.find(this->dataset[i]->get_name());
+	if (it != this->name_index.end() && it->second == i)
+		this->name_index.erase(it);
+}
+
+bool Dataset::parse_object_line(const std::string & line, std::string & object_name, std::vector <float> & input_data)
+{
+	std::string field;
+	std::size_t start = 0, end;
+	bool first = true;
+
+	input_data.clear();
+
+	// fields are tab separated, first field is the name and the rest are the coordinates
+	do
+	{
+		end = line.find('\t', start);
+		field = line.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+
+		if (!field.empty() && field[field.size()-1] == '\r')	// remove potential \r character
+			field.erase(field.size()-1);
+
+		if (first)
+			object_name = field;
+		else if (!field.empty())
+			input_data.push_back(atof(field.c_str()));
+
+		first = false;
+		start = end + 1;
+	} while (end != std::string::npos);
+
+	return !object_name.empty();
 }
\ No newline at end of file
@@ -3,13 +3,21 @@
 #define _DATASET_HPP_
 #include <iostream>
 #include <string>
+#include <vector>
+#include <unordered_map>
 #include "object.hpp"
 
+// type of the Abstract Objects a dataset holds, depends on the algorithm and metric given
+enum object_type {VECTOR_OBJECT, TIME_SERIES_OBJECT, FILTERED_CURVE_OBJECT};
+
 // class Dataset is simply a collection of Abstract-Objects
+// objects can be inserted and removed after construction, a removed object keeps its slot (and id) so that ids of other objects never change
 class Dataset
 {
 private:
-	Abstract_Object ** dataset; 		// an array of pointers to Abstract-Objects
+	std::vector <Abstract_Object *> dataset; 	// an array of pointers to Abstract-Objects
+	std::vector <bool> removed;					// for each object, true if it has been removed
+	std::unordered_map <std::string, int> name_index;	// id of each (not removed) object, by its name
 	int num_of_Objects;
 
 public:
@@ -22,6 +30,24 @@ public:
 	int get_num_of_Objects() const;
 	// returns i-th object of dataset;
 	const Abstract_Object& get_ith_object(int i) const;
+	// returns true if i-th object of dataset has been removed
+	bool is_removed(int i) const;
+	// returns id of object with given name, or -1 if there is no such object
+	int find(const std::string & object_name) const;
+
+	// inserts given object (dataset takes ownership of it) and returns its id
+	int insert(Abstract_Object * object);
+	// marks i-th object of dataset as removed, the object itself is kept so that structures still pointing to it stay valid
+	void remove(int i);
+
+	// returns the type of objects used by the algorithm and metric given (checked once, not for each object)
+	static object_type current_object_type();
+	// creates a new Abstract Object of given type from the coordinates and name read from an input line
+	static Abstract_Object * create_object(object_type type, std::vector <float> & input_data, std::string & object_name);
+	// creates a new Abstract Object from the coordinates and name read from an input line, of the type used by the algorithm
+	static Abstract_Object * create_object(std::vector <float> & input_data, std::string & object_name);
+	// parses a line of the input file form (name and coordinates, tab separated), returns false if there is no name
+	static bool parse_object_line(const std::string & line, std::string & object_name, std::vector <float> & input_data);
 	
 };
 
@@ -5,24 +5,49 @@
 #include <iostream>
 #include <random>
 #include <cmath>
+#include <vector>
 
-h_hash::h_hash()
+h_hash::h_hash(rng & generator, int dim, int w) : v(generator, dim), w(w)
 {
-	// calls default constructor for point Object v, which makes v a random normalized vector-point
+	// v is made a random normalized vector-point by its constructor
 	// picks single precision real t uniformly in [0,w)
 	const float lower_bound = 0.0;
 	const int upper_bound = w;
-	std::random_device rd;
-	std::mt19937 generator(rd());
-	std::uniform_real_distribution<float> distr(lower_bound, upper_bound);
 
-	t = distr(generator);
+	t = generator.uniform(lower_bound, upper_bound);
 
 }
 
+// reads the random vector v of an h hash function from an index snapshot
+static Object read_vector(index_reader & reader)
+{
+	uint64_t dim = 0;
+	const float * coordinates = reader.read_array<float>(dim);
+
+	return Object(coordinates, (int) dim);
+}
+
+h_hash::h_hash(index_reader & reader, int w) : v(read_vector(reader)), t(reader.read<float>()), w(w) {}
+
+void h_hash::save(index_writer & writer) const
+{
+	std::vector <float> coordinates(this->v.get_dim());
+
+	for (int i = 0; i < this->v.get_dim(); ++i)
+		coordinates[i] = this->v.get_ith(i);
+
+	writer.write_array(coordinates.data(), coordinates.size());
+	writer.write(this->t);
+}
+
 int h_hash::operator()(const Object& p) const
 {
-	return floor(((this->v).inner_prod(p) + this->t) / w);		// definition of h hash function
+	return floor(this->project(p));		// definition of h hash function
+}
+
+float h_hash::project(const Object& p) const
+{
+	return ((this->v).inner_prod(p) + this->t) / this->w;
 }
 
 void h_hash::print() const
@@ -3,6 +3,8 @@
 #define _H_HASH_HPP_
 #include <iostream>
 #include "object.hpp"
+#include "index_io.hpp"
+#include "rng.hpp"
 
 // class h_hash is used to hold info about an h hash function
 
@@ -11,12 +13,19 @@ class h_hash
 private:
 	Object v;	// a random normalized vector-point
 	float t;	// a single precision real t uniformly in [0,w)	
+	int w;		// window parameter
 
 public:
-	// default constructor, randomly chooses v,t
-	h_hash();
+	// constructor, randomly chooses v (of dimension dim) and t using given generator
+	h_hash(rng & generator, int dim, int w);
+	// constructor through an index snapshot, reads v,t
+	h_hash(index_reader & reader, int w);
+	// writes v,t to an index snapshot
+	void save(index_writer & writer) const;
 	// overload of () operator, so that each h_hash object can be used as a "function"
-	int operator()(const Object& p) const;	
+	int operator()(const Object& p) const;
+	// returns the projection (v.p + t) / w of given object, the h hash value is its floor
+	float project(const Object& p) const;	
 	// print method for debugging
 	void print() const;
 };
@@ -0,0 +1,197 @@
+//file:index_io.cpp//
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "index_io.hpp"
+#include "params.hpp"
+
+/////////////////////////////// CLASS INDEX_WRITER ///////////////////////////////////////////
+
+index_writer::index_writer(const std::string & index_file) : offset(0), failed(false)
+{
+	this->file = fopen(index_file.c_str(), "wb");
+	if (this->file == NULL)
+		this->failed = true;
+}
+
+index_writer::~index_writer()
+{
+	if (this->file != NULL)
+		fclose(this->file);
+}
+
+bool index_writer::is_open() const
+{
+	return this->file != NULL;
+}
+
+bool index_writer::good() const
+{
+	return !this->failed && this->file != NULL && !ferror(this->file);
+}
+
+void index_writer::write_bytes(const void * data, uint64_t bytes)
+{
+	if (this->failed)
+		return;
+
+	if (fwrite(data, 1, bytes, this->file) != bytes)
+		this->failed = true;
+
+	this->offset += bytes;
+}
+
+void index_writer::pad()
+{
+	static const char zeros[8] = {0};
+
+	if (this->offset % 8 != 0)
+		this->write_bytes(zeros, 8 - this->offset % 8);
+}
+
+void index_writer::write_string(const std::string & str)
+{
+	this->write_array(str.data(), str.size());
+}
+
+/////////////////////////////// CLASS INDEX_READER ///////////////////////////////////////////
+
+index_reader::index_reader(const std::string & index_file) : map(nullptr), map_size(0), offset(0), failed(false), version(INDEX_VERSION)
+{
+	int fd = open(index_file.c_str(), O_RDONLY);
+	if (fd < 0)
+	{
+		this->failed = true;
+		return;
+	}
+
+	struct stat file_info;
+	if (fstat(fd, &file_info) < 0 || file_info.st_size == 0)
+	{
+		close(fd);
+		this->failed = true;
+		return;
+	}
+
+	// map the whole file read only, arrays are then read in place from the mapping
+	void * address = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);		// mapping stays valid after closing the file descriptor
+
+	if (address == MAP_FAILED)
+	{
+		this->failed = true;
+		return;
+	}
+
+	this->map = static_cast<const char *>(address);
+	this->map_size = file_info.st_size;
+}
+
+index_reader::~index_reader()
+{
+	if (this->map != nullptr)
+		munmap(const_cast<char *>(this->map), this->map_size);
+}
+
+bool index_reader::is_open() const
+{
+	return this->map != nullptr;
+}
+
+bool index_reader::good() const
+{
+	return !this->failed;
+}
+
+void index_reader::fail()
+{
+	this->failed = true;
+}
+
+uint32_t index_reader::get_version() const
+{
+	return this->version;
+}
+
+void index_reader::set_version(uint32_t version)
+{
+	this->version = version;
+}
+
+void index_reader::align()
+{
+	if (this->offset % 8 != 0)
+		this->offset += 8 - this->offset % 8;
+
+	if (this->offset > this->map_size)
+		this->offset = this->map_size;
+}
+
+std::string index_reader::read_string()
+{
+	uint64_t length = 0;
+	const char * str = this->read_array<char>(length);
+
+	if (str == nullptr)
+		return "";
+
+	return std::string(str, length);
+}
+
+/////////////////////////////// SNAPSHOT HEADER ///////////////////////////////////////////
+
+void write_index_header(index_writer & writer, const std::string & structure, const std::string & algorithm, const std::string & metric, int num_of_Objects, const index_params & params)
+{
+	writer.write_string(INDEX_MAGIC);
+	writer.write((uint32_t) INDEX_VERSION);
+	writer.write_string(structure);
+	writer.write_string(algorithm);
+	writer.write_string(metric);
+
+	// parameters the structure was built with
+	writer.write((int32_t) num_of_Objects);
+	writer.write((int32_t) params.dim);
+	writer.write((int32_t) params.k);
+	writer.write((int32_t) params.L);
+	writer.write((int32_t) params.d1);
+	writer.write((int32_t) params.w);
+	writer.write(params.delta);
+}
+
+bool read_index_header(index_reader & reader, std::string & structure, std::string & algorithm, std::string & metric, int & num_of_Objects, index_params & params)
+{
+	// check that file is an index snapshot, of a layout version we can read
+	if (reader.read_string() != INDEX_MAGIC)
+		return false;
+
+	uint32_t version = reader.read<uint32_t>();
+	if (version < INDEX_MIN_VERSION || version > INDEX_VERSION)
+		return false;
+	reader.set_version(version);
+
+	structure = reader.read_string();
+	algorithm = reader.read_string();
+	metric = reader.read_string();
+
+	// parameters the structure was built with
+	num_of_Objects = reader.read<int32_t>();
+	params.dim = reader.read<int32_t>();
+	params.k = reader.read<int32_t>();
+	params.L = reader.read<int32_t>();
+	params.d1 = reader.read<int32_t>();
+	params.w = reader.read<int32_t>();
+	params.delta = reader.read<double>();
+
+	// the parameters size what is built next (e.g. 2^d1 vertices and probe masks) and the hash functions divide by w (and curves by delta),
+	// so a snapshot with invalid ones is rejected
+	if (params.k <= 0 || params.L <= 0 || params.d1 < 1 || params.d1 > INDEX_MAX_D1 || params.w <= 0 || (!metric.empty() && params.delta <= 0))
+		reader.fail();
+
+	return reader.good();
+}
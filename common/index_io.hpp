@@ -0,0 +1,143 @@
+//file:index_io.hpp//
+#ifndef _INDEX_IO_HPP_
+#define _INDEX_IO_HPP_
+#include <iostream>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include "index_params.hpp"
+
+// index snapshot files hold a complete built search structure (hash functions and bucket contents as object ids)
+// every scalar and array in the file is aligned at 8 bytes and every array is preceded by its length,
+// so a snapshot file is memory mapped when loaded and its arrays are read in place
+
+#define INDEX_MAGIC "CRVINDEX"		// first 8 bytes of every snapshot file
+#define INDEX_VERSION 2				// version of the snapshot file layout
+#define INDEX_MIN_VERSION 1			// oldest layout version that can still be loaded (version 1 stored the f functions of the hypercube as maps)
+#define INDEX_MAX_D1 30				// largest hypercube dimension a snapshot may have (the cube allocates 2^d1 vertices)
+
+// class index_writer writes the parts of a built index to a snapshot file
+class index_writer
+{
+private:
+	FILE * file;		// snapshot file, opened in binary write mode
+	uint64_t offset;	// number of bytes written so far
+	bool failed;		// true if any write failed
+
+	// writes raw bytes to file
+	void write_bytes(const void * data, uint64_t bytes);
+	// writes zero bytes until offset is aligned at 8 bytes
+	void pad();
+
+public:
+	// opens given snapshot file for writing
+	index_writer(const std::string & index_file);
+	// closes snapshot file
+	~index_writer();
+	// returns true if snapshot file was opened properly
+	bool is_open() const;
+	// returns true if every write so far succeeded
+	bool good() const;
+
+	// writes a single value of a trivially copyable type
+	template <typename T>
+	void write(const T & value)
+	{
+		this->write_bytes(&value, sizeof(T));
+		this->pad();
+	}
+
+	// writes the length of given array and then its count elements
+	template <typename T>
+	void write_array(const T * array, uint64_t count)
+	{
+		this->write(count);
+		if (count > 0)
+			this->write_bytes(array, count * sizeof(T));
+		this->pad();
+	}
+
+	// writes a string as an array of chars
+	void write_string(const std::string & str);
+};
+
+// class index_reader memory maps a snapshot file and reads back the parts of an index, in the order they were written
+class index_reader
+{
+private:
+	const char * map;	// memory mapped snapshot file
+	uint64_t map_size;	// size of snapshot file in bytes
+	uint64_t offset;	// number of bytes read so far
+	bool failed;		// true if any read went past the end of file, or the file contents were found invalid
+	uint32_t version;	// layout version of the snapshot, set when its header is read
+
+	// moves offset to next position aligned at 8 bytes
+	void align();
+
+public:
+	// opens and memory maps given snapshot file for reading
+	index_reader(const std::string & index_file);
+	// unmaps snapshot file
+	~index_reader();
+	// returns true if snapshot file was opened and mapped properly
+	bool is_open() const;
+	// returns true if every read so far succeeded
+	bool good() const;
+	// marks the snapshot as invalid, used when the contents read are inconsistent
+	void fail();
+	// returns the layout version of the snapshot (valid after its header is read)
+	uint32_t get_version() const;
+	// sets the layout version of the snapshot, as read from its header
+	void set_version(uint32_t version);
+
+	// reads a single value of a trivially copyable type (zero value if the snapshot is invalid)
+	template <typename T>
+	T read()
+	{
+		T value;
+		memset(&value, 0, sizeof(T));
+
+		if (this->failed || this->offset + sizeof(T) > this->map_size)
+		{
+			this->failed = true;
+			return value;
+		}
+
+		memcpy(&value, this->map + this->offset, sizeof(T));
+		this->offset += sizeof(T);
+		this->align();
+		return value;
+	}
+
+	// returns a pointer to the mapped elements of an array and its length in count (nullptr if the snapshot is invalid)
+	template <typename T>
+	const T * read_array(uint64_t & count)
+	{
+		count = this->read<uint64_t>();
+
+		if (this->failed || count > (this->map_size - this->offset) / sizeof(T))
+		{
+			this->failed = true;
+			count = 0;
+			return nullptr;
+		}
+
+		const T * array = reinterpret_cast<const T *>(this->map + this->offset);
+		this->offset += count * sizeof(T);
+		this->align();
+		return array;
+	}
+
+	// reads a string written as an array of chars
+	std::string read_string();
+};
+
+// writes the snapshot header : the type of search structure, the algorithm and metric, and the parameters the structure was built with
+void write_index_header(index_writer & writer, const std::string & structure, const std::string & algorithm, const std::string & metric, int num_of_Objects, const index_params & params);
+
+// reads the snapshot header (of any version from INDEX_MIN_VERSION to INDEX_VERSION), returns the type of search structure, the algorithm and metric, the number of objects
+// and the parameters the structure was built with (M and probes are not part of the snapshot, they are left as they are)
+bool read_index_header(index_reader & reader, std::string & structure, std::string & algorithm, std::string & metric, int & num_of_Objects, index_params & params);
+
+#endif
@@ -0,0 +1,48 @@
+//file:index_params.hpp//
+#ifndef _INDEX_PARAMS_HPP_
+#define _INDEX_PARAMS_HPP_
+#include "params.hpp"
+
+// struct index_params holds the parameters a search structure is built with
+// each structure keeps its own copy, instead of reading the global program parameters,
+// so that differently configured structures can live in the same program
+struct index_params
+{
+	int dim;		// dimension (or complexity) of the dataset objects
+	int k;			// number of h hash functions composing each amplified g hash function (lsh)
+	int L;			// number of hash tables (lsh)
+	int d1;			// dimension of the hypercube
+	int M;			// max number of objects checked per query (hypercube)
+	int probes;		// max number of vertices checked per query (hypercube)
+	bool query_directed;	// true if vertices are probed in query-directed order instead of hamming distance order (hypercube)
+	int w;			// window parameter of the h hash functions
+	double delta;	// size of the grid cells that curves are snapped to (frechet)
+	double bucket_load;	// distinct locality IDs per bucket, the hash tables are resized to once the dataset is imported (0 keeps their size) (lsh)
+	int max_distances;	// max number of distances evaluated per approximate kNN query (0 for no limit)
+	int max_probes;		// max number of buckets (or vertices) probed per approximate kNN query (0 for no limit)
+	double deadline_ms;	// max wall clock time per approximate kNN query in milliseconds (0 for no limit)
+};
+
+// returns the parameters currently set in the global program parameters
+inline index_params global_index_params()
+{
+	index_params params;
+
+	params.dim = d;
+	params.k = k;
+	params.L = L;
+	params.d1 = d1;
+	params.M = M;
+	params.probes = probes;
+	params.query_directed = false;
+	params.w = w;
+	params.delta = delta;
+	params.bucket_load = 0.0;
+	params.max_distances = 0;
+	params.max_probes = 0;
+	params.deadline_ms = 0.0;
+
+	return params;
+}
+
+#endif
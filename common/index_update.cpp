@@ -0,0 +1,86 @@
+//file:index_update.cpp//
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "index_update.hpp"
+#include "params.hpp"
+
+bool upsert_object(const std::string & line, Dataset & dataset, search_method & method)
+{
+	std::string object_name;
+	std::vector <float> input_data;
+
+	// object should have the dimension of the dataset objects
+	if (!Dataset::parse_object_line(line, object_name, input_data) || (int) input_data.size() != d)
+		return false;
+
+	// an object with the same name is replaced
+	int old_id = dataset.find(object_name);
+	if (old_id >= 0)
+	{
+		method.remove(dataset.get_ith_object(old_id));
+		dataset.remove(old_id);
+	}
+
+	int id = dataset.insert(Dataset::create_object(input_data, object_name));
+	method.insert(dataset.get_ith_object(id));
+
+	return true;
+}
+
+bool remove_object(const std::string & object_name, Dataset & dataset, search_method & method)
+{
+	int id = dataset.find(object_name);
+
+	if (id < 0)		// no such object
+		return false;
+
+	// search struct is updated first, while the object is still part of the dataset
+	method.remove(dataset.get_ith_object(id));
+	dataset.remove(id);
+
+	return true;
+}
+
+bool apply_delta_file(const std::string & delta_file, Dataset & dataset, search_method & method, int & upserted, int & removed)
+{
+	std::ifstream file (delta_file, std::ios::in);
+	upserted = 0;
+	removed = 0;
+
+	if (!file.is_open())		// check if file was opened properly
+		return false;
+
+	std::string line;
+
+	while (std::getline(file, line))
+	{
+		if (!line.empty() && line[line.size()-1] == '\r')	// remove potential \r character
+			line.erase(line.size()-1);
+
+		if (line.empty())		// ignore empty lines
+			continue;
+
+		// update type and then a tab, followed by the object line or the object name
+		if (line.size() < 3 || line[1] != '\t')
+			return false;
+
+		if (line[0] == '+')
+		{
+			if (!upsert_object(line.substr(2), dataset, method))
+				return false;
+			upserted++;
+		}
+		else if (line[0] == '-')
+		{
+			// removing an object that is not in the dataset is not an error, the delta may be applied more than once
+			if (remove_object(line.substr(2), dataset, method))
+				removed++;
+		}
+		else
+			return false;
+	}
+
+	return true;
+}
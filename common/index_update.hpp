@@ -0,0 +1,27 @@
+//file:index_update.hpp//
+#ifndef _INDEX_UPDATE_HPP_
+#define _INDEX_UPDATE_HPP_
+#include <iostream>
+#include <string>
+#include "dataset.hpp"
+#include "object.hpp"
+#include "search_method.hpp"
+
+// updates of a built index (and its dataset) without a full rebuild
+//
+// a delta file holds one update per line, tab separated :
+//	+	<name>	<x1>	<x2>...		--> inserts the object, or replaces the object with the same name (upsert)
+//	-	<name>						--> removes the object with given name
+
+// inserts the object encoded in line (input file form : name and coordinates, tab separated) into dataset and search struct
+// an object with the same name is removed first, returns false if line is not a valid object of the dataset dimension
+bool upsert_object(const std::string & line, Dataset & dataset, search_method & method);
+
+// removes the object with given name from dataset and search struct, returns false if there is no such object
+bool remove_object(const std::string & object_name, Dataset & dataset, search_method & method);
+
+// applies all updates of given delta file and returns the number of objects upserted and removed
+// returns false if file could not be opened or has an invalid line (updates before that line are kept)
+bool apply_delta_file(const std::string & delta_file, Dataset & dataset, search_method & method, int & upserted, int & removed);
+
+#endif
@@ -3,6 +3,8 @@
 #include <string>
 #include <cstring>
 #include <cstdlib>
+#include <fstream>
+#include <sstream>
 #include "input_check.hpp"
 #include "params.hpp"
 #include "assist_functions.hpp"
@@ -393,7 +395,8 @@ bool read_input_file(std::string & input_file, int & n, int & d)
 
 // check and set arguments for curve search (incluces check_init_args for lsh and hypercube)
 bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & query_file, int & k, int & d1, int & L, int & M, int & probes, 
-	std::string & output_file, std::string & algorithm, std::string & metric, double & delta)
+	std::string & output_file, std::string & algorithm, std::string & metric, double & delta, std::string & server, std::string & load_index, std::string & save_index, std::string & delta_file, long long & seed, std::string & probe_order, std::string & tune_file, std::string & tuned_file, double & bucket_load,
+	int & max_distances, int & max_probes, double & deadline_ms, int & threads)
 {
 	// set default values for the parameters, in case no specific value was given through terminal (all cmd parameters are optional)
 	input_file = "";
@@ -407,12 +410,25 @@ bool check_init_args(int argc, const char ** argv, std::string & input_file, std
 	M = 10;
 	probes = 2;
 	delta = 0;
+	server = "";
+	load_index = "";
+	save_index = "";
+	delta_file = "";
+	seed = -1;		// no seed given, a different one is used on every run
+	probe_order = "hamming";
+	tune_file = "";
+	tuned_file = "";
+	bucket_load = 0;		// hash tables keep the number of buckets they were created with
+	max_distances = 0;		// no query budget
+	max_probes = 0;
+	deadline_ms = 0;
+	threads = 0;			// as many threads as hardware threads
 
 	// cmd input should have an odd number of args (an even number due to ("-x", value) pairs , plus the argv[0])
 	if (argc % 2 == 0)
 		return false;
 	int i = 2;
-	// cmd input should have "-x" at odd positions (x is in {i, q, o, k, L, M, probes, algorithm, metric, delta}) and actual parameter values at even positions
+	// cmd input should have "-x" at odd positions (x is in {i, q, o, k, L, M, probes, algorithm, metric, delta, server, load-index, save-index, delta-file, seed, probe-order, tune, tuned, bucket-load, max-distances, max-probes, deadline, threads}) and actual parameter values at even positions
 	while (i < argc)
 	{
 		if (!strcmp(argv[i-1], "-i"))
@@ -475,117 +491,343 @@ bool check_init_args(int argc, const char ** argv, std::string & input_file, std
 				return false;
 			delta = atof(argv[i]);
 		}
-		
+		else if (!strcmp(argv[i-1], "-server"))
+		{
+			server = argv[i];		// either stdio, or the path of the unix domain socket to listen on
+		}
+		else if (!strcmp(argv[i-1], "-load-index"))
+		{
+			load_index = argv[i];	// index snapshot to load instead of importing the dataset
+		}
+		else if (!strcmp(argv[i-1], "-save-index"))
+		{
+			save_index = argv[i];	// index snapshot to write after the index is built
+		}
+		else if (!strcmp(argv[i-1], "-delta-file"))
+		{
+			delta_file = argv[i];	// updates (inserts and removes) to apply after the index is built
+		}
+		else if (!strcmp(argv[i-1], "-seed"))
+		{
+			if (!is_integer(argv[i]))
+				return false;
+			seed = atoll(argv[i]);	// seed of the random generator, for reproducible runs
+		}
+		else if (!strcmp(argv[i-1], "-probe-order"))
+		{
+			if (strcmp(argv[i], "hamming") && strcmp(argv[i], "query"))
+				return false;		// hypercube vertices are probed either in hamming distance order or in query-directed order
+
+			probe_order = argv[i];
+		}
+		else if (!strcmp(argv[i-1], "-tune"))
+		{
+			tune_file = argv[i];	// tuning mode : sweeps the parameters and writes the configuration chosen to this file
+		}
+		else if (!strcmp(argv[i-1], "-tuned"))
+		{
+			tuned_file = argv[i];	// configuration written by a previous tuning run
+		}
+		else if (!strcmp(argv[i-1], "-bucket-load"))
+		{
+			if (atof(argv[i]) <= 0)	// error in string to double conversion, or not positive
+				return false;
+			bucket_load = atof(argv[i]);	// distinct locality IDs per bucket of the lsh hash tables
+		}
+		else if (!strcmp(argv[i-1], "-max-distances"))
+		{
+			if (!is_integer(argv[i]) || !atoi(argv[i]))
+				return false;
+			max_distances = atoi(argv[i]);	// query budget : distances evaluated per approximate kNN query
+		}
+		else if (!strcmp(argv[i-1], "-max-probes"))
+		{
+			if (!is_integer(argv[i]) || !atoi(argv[i]))
+				return false;
+			max_probes = atoi(argv[i]);		// query budget : buckets (or vertices) probed per approximate kNN query
+		}
+		else if (!strcmp(argv[i-1], "-deadline"))
+		{
+			if (atof(argv[i]) <= 0)	// error in string to double conversion, or not positive
+				return false;
+			deadline_ms = atof(argv[i]);	// query budget : milliseconds per approximate kNN query
+		}
+		else if (!strcmp(argv[i-1], "-threads"))
+		{
+			if (!is_integer(argv[i]) || !atoi(argv[i]))
+				return false;
+			threads = atoi(argv[i]);		// threads of the exact (brute force) searches
+		}
 		else
 			return false;
 
 		i+=2;
 	}
 
-	if (!algorithm.empty() && algorithm != "Frechet" && !metric.empty())	// metric only to be used with algorithm Frechet
+	if (algorithm == "LSH" && !metric.empty())	// metric only to be used with algorithm Frechet or Hypercube
+		return false;
+
+	if (!delta_file.empty() && !save_index.empty())		// snapshots refer to the objects of the input file only
+		return false;
+
+	if (!tune_file.empty() && (!load_index.empty() || !server.empty() || !tuned_file.empty()))	// tuning builds its own structures
 		return false;
 
 	return true;
 }
 
 // checks for correct input args from terminal and initializes program parameters if so (for clustering)
-bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & config_file, std::string & output_file, std::string & update_method, std::string & assignment_method, bool& complete, bool& silhouette)
+bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & config_file, std::string & output_file, std::string & update_method, std::string & assignment_method, bool& complete, bool& silhouette, long long & seed, std::string & tuned_file, int & threads,
+	int & batch_size, int & batch_iterations, bool & full_assignment, std::string & init_method, double & oversampling)
 {
-	// all cmd parameters here are mandatory (for clustering), except for -complete and -silhouette
-	if (argc != 12 && argc != 13 && argc != 14)
-	{
-		std::cerr << "\nWrong command line input. Use : ./cluster -i <input_file> -c <config_file> -o <output_file> -update <update_method> -assignment <assignment_method> -complete <optional> -silhouette <optional>\n";
-		std::cerr << "-complete is optional, -silhouette is optional, <update_method> is Mean Frechet or Mean Vector, <assignment_method> is Classic or LSH or Hypercube or LSH_Frechet\n\n";
-		return false;
-	}
+	const char * usage = "Use : -i -c -o -update -assignment -complete <optional> -silhouette <optional> -seed <optional int> -tuned <optional tuned_file> -threads <optional int>"
+		" -batch-size <optional int> -batch-iterations <optional int> -full-assignment <optional> -init <optional KMeans++ or KMeansParallel> -oversampling <optional double>\n\n";
 
-	if (strcmp(argv[1], "-i") != 0 || strcmp(argv[3], "-c") != 0 || strcmp(argv[5], "-o") != 0 || strcmp(argv[7], "-update") != 0 || strcmp(argv[10], "-assignment") != 0 )
+	input_file = "";
+	config_file = "";
+	output_file = "";
+	update_method = "";
+	assignment_method = "";
+	complete = false;
+	silhouette = false;
+	seed = -1;		// no seed given, a different one is used on every run
+	tuned_file = "";
+	threads = 0;			// as many threads as hardware threads
+	batch_size = 0;			// default batch size and iterations of mini-batch k-means (see cluster_info.hpp)
+	batch_iterations = 0;
+	full_assignment = false;
+	init_method = "KMeans++";
+	oversampling = 0;		// default oversampling of k-means|| (see cluster_info.hpp)
+
+	// -i, -c, -o, -update, -assignment are mandatory (for clustering), the rest are optional
+	// <update_method> takes 2 args (Mean Frechet or Mean Vector), -complete, -silhouette and -full-assignment take none, the rest take 1
+	int i = 1;
+	while (i < argc)
 	{
-		std::cerr << "\nError: one or more wrong input parameters" << std::endl << "Use : -i -c -o -update -assignment -complete <optional> -silhouette <optional>\n\n";
-		return false;
-	}
+		if (!strcmp(argv[i], "-complete"))
+		{
+			complete = true;
+			i++;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-silhouette"))
+		{
+			silhouette = true;
+			i++;
+			continue;
+		}
+		else if (!strcmp(argv[i], "-full-assignment"))
+		{
+			full_assignment = true;		// mini-batch k-means ends with an exact assignment of all objects
+			i++;
+			continue;
+		}
 
-	// initialize files
-	input_file = argv[2];
-	config_file = argv[4];
-	output_file = argv[6];
+		if (i + 1 >= argc)		// every other parameter is followed by its value
+		{
+			std::cerr << "\nError: missing value for input parameter " << argv[i] << std::endl << usage;
+			return false;
+		}
 
-	// check if <update_method> is either Mean Frechet or Mean Vector
-	if (strcmp(argv[8], "Mean") != 0 || (strcmp(argv[9], "Vector") != 0 && strcmp(argv[9], "Frechet") != 0))
-	{
-		std::cerr << "\nError: invalid input parameter <update_method>" << std::endl << "Use : <update_method> --> Mean Frechet or Mean Vector\n\n";
-		return false;
-	}
+		if (!strcmp(argv[i], "-i"))
+			input_file = argv[i+1];
+		else if (!strcmp(argv[i], "-c"))
+			config_file = argv[i+1];
+		else if (!strcmp(argv[i], "-o"))
+			output_file = argv[i+1];
+		else if (!strcmp(argv[i], "-update"))
+		{
+			// check if <update_method> is either Mean Frechet or Mean Vector
+			if (i + 2 >= argc || strcmp(argv[i+1], "Mean") != 0 || (strcmp(argv[i+2], "Vector") != 0 && strcmp(argv[i+2], "Frechet") != 0))
+			{
+				std::cerr << "\nError: invalid input parameter <update_method>" << std::endl << "Use : <update_method> --> Mean Frechet or Mean Vector\n\n";
+				return false;
+			}
+
+			// initialize update_method
+			update_method = argv[i+1];
+			update_method += " ";
+			update_method += argv[i+2];
+			i++;
+		}
+		else if (!strcmp(argv[i], "-assignment"))
+		{
+			// check if <assignment_method> is either Classic or Elkan or Hamerly or MiniBatch or LSH or Hypercube or LSH_Frechet
+			if (strcmp(argv[i+1], "Classic") != 0 && strcmp(argv[i+1], "Elkan") != 0 && strcmp(argv[i+1], "Hamerly") != 0 && strcmp(argv[i+1], "MiniBatch") != 0
+				&& strcmp(argv[i+1], "LSH") != 0 && strcmp(argv[i+1], "Hypercube") != 0 && strcmp(argv[i+1], "LSH_Frechet") != 0)
+			{
+				std::cerr << "\nError: invalid input parameter <assignment_method>" << std::endl << "Use : <assignment_method> --> Classic or Elkan or Hamerly or MiniBatch or LSH or Hypercube or LSH_Frechet\n\n";
+				return false;
+			}
 
-	// initialize update_method
-	update_method = argv[8];
-	std::string str = argv[9];
-	update_method += " ";
-	update_method += str;
+			// initialize assignment_method
+			assignment_method = argv[i+1];
+		}
+		else if (!strcmp(argv[i], "-seed"))
+		{
+			if (!is_integer(argv[i+1]))
+			{
+				std::cerr << "\nError: -seed expects a non negative integer" << std::endl << usage;
+				return false;
+			}
+			seed = atoll(argv[i+1]);	// seed of the random generator, for reproducible runs
+		}
+		else if (!strcmp(argv[i], "-tuned"))
+			tuned_file = argv[i+1];		// configuration written by search -tune, replaces the hash parameters of the config file
+		else if (!strcmp(argv[i], "-threads"))
+		{
+			if (!is_integer(argv[i+1]) || !atoi(argv[i+1]))
+			{
+				std::cerr << "\nError: -threads expects a positive integer" << std::endl << usage;
+				return false;
+			}
+			threads = atoi(argv[i+1]);		// threads of the assignment and update steps of clustering
+		}
+		else if (!strcmp(argv[i], "-batch-size") || !strcmp(argv[i], "-batch-iterations"))
+		{
+			if (!is_integer(argv[i+1]) || !atoi(argv[i+1]))
+			{
+				std::cerr << "\nError: " << argv[i] << " expects a positive integer" << std::endl << usage;
+				return false;
+			}
+			if (!strcmp(argv[i], "-batch-size"))
+				batch_size = atoi(argv[i+1]);			// objects sampled in each iteration of mini-batch k-means
+			else
+				batch_iterations = atoi(argv[i+1]);		// iterations of mini-batch k-means
+		}
+		else if (!strcmp(argv[i], "-init"))
+		{
+			if (strcmp(argv[i+1], "KMeans++") != 0 && strcmp(argv[i+1], "KMeansParallel") != 0)
+			{
+				std::cerr << "\nError: invalid input parameter <init_method>" << std::endl << "Use : <init_method> --> KMeans++ or KMeansParallel (k-means||)\n\n";
+				return false;
+			}
+			init_method = argv[i+1];
+		}
+		else if (!strcmp(argv[i], "-oversampling"))
+		{
+			if (atof(argv[i+1]) <= 0)	// error in string to double conversion, or not positive
+			{
+				std::cerr << "\nError: -oversampling expects a positive number" << std::endl << usage;
+				return false;
+			}
+			oversampling = atof(argv[i+1]);		// candidates sampled per round of k-means||, as a multiple of K
+		}
+		else
+		{
+			std::cerr << "\nError: one or more wrong input parameters" << std::endl << usage;
+			return false;
+		}
 
-	// check if <assignment_method> is either Classic or LSH or Hypercube or LSH_Frechet
-	if (strcmp(argv[11], "Classic") != 0 && strcmp(argv[11], "LSH") != 0 && strcmp(argv[11], "Hypercube") != 0 && strcmp(argv[11], "LSH_Frechet") != 0)
+		i += 2;
+	}
+
+	if (input_file.empty() || config_file.empty() || output_file.empty() || update_method.empty() || assignment_method.empty())
 	{
-		std::cerr << "\nError: invalid input parameter <assignment_method>" << std::endl << "Use : <assignment_method> --> Classic or LSH or Hypercube or LSH_Frechet\n\n";
+		std::cerr << "\nWrong command line input. Use : ./cluster -i <input_file> -c <config_file> -o <output_file> -update <update_method> -assignment <assignment_method> -complete <optional> -silhouette <optional> -seed <optional int> -tuned <optional tuned_file> -threads <optional int>"
+			" -batch-size <optional int> -batch-iterations <optional int> -full-assignment <optional> -init <optional init_method> -oversampling <optional double>\n";
+		std::cerr << "-complete, -silhouette, -seed, -tuned, -threads, -batch-size, -batch-iterations, -full-assignment, -init and -oversampling are optional, <init_method> is KMeans++ or KMeansParallel, <update_method> is Mean Frechet or Mean Vector, <assignment_method> is Classic or Elkan or Hamerly or MiniBatch or LSH or Hypercube or LSH_Frechet\n\n";
 		return false;
 	}
 
-	// initialize assignment_method
-	assignment_method = argv[11];
-
 	// check if pair of update_method and assignment_method is valid
 	if (update_method == "Mean Vector"  &&  assignment_method == "LSH_Frechet")
 	{
 		std::cerr << "\nMean Vector <update_method> is not compatible with LSH_Frechet <assignment_method>\n";
-		std::cerr << "Use : <assignment_method> --> Classic or LSH or Hypercube  , when <update_method> = Mean Vector\n\n";
+		std::cerr << "Use : <assignment_method> --> Classic or Elkan or Hamerly or MiniBatch or LSH or Hypercube  , when <update_method> = Mean Vector\n\n";
 		return false;
 	}
 
-	if (update_method == "Mean Frechet"  &&  (assignment_method == "LSH" || assignment_method == "Hypercube"))
+	if (update_method == "Mean Frechet"  &&  (assignment_method == "LSH" || assignment_method == "Hypercube" || assignment_method == "MiniBatch"))
 	{
 		std::cerr << "Mean Frechet <update_method> is not compatible with " << assignment_method << " <assignment_method>\n";
-		std::cerr << "Use : <assignment_method> --> Classic or LSH_Frechet  , when <update_method> = Mean Frechet\n\n";
+		std::cerr << "Use : <assignment_method> --> Classic or Elkan or Hamerly or LSH_Frechet  , when <update_method> = Mean Frechet\n\n";
 		return false;
 	}
 
-	// check if -complete or -silhouette were given
-	if (argc == 12)
+	return true;
+}
+
+bool read_tuned_file(const std::string & tuned_file, std::string & algorithm, std::string & metric, int & k, int & L, int & d1, int & M, int & probes, int & w, double & delta)
+{
+	std::ifstream file(tuned_file);
+
+	if (!file.is_open())
 	{
-		complete = false;
-		silhouette = false;
+		std::cerr << "\nGiven tuned file path/name could not be found (invalid file path)\n\n";
+		return false;
 	}
-	else if (argc == 13)
+
+	algorithm = "";
+	metric = "";
+
+	std::string line;
+	while (std::getline(file, line))
 	{
-		if (!strcmp(argv[12], "-complete"))
+		if (!line.empty() && line[line.size()-1] == '\r')	// remove potential \r character
+			line.erase(line.size()-1);
+
+		if (line.empty() || line[0] == '#')		// skip empty lines and comments
+			continue;
+
+		// each line is of the form : description: value
+		std::istringstream words(line);
+		std::string desc, value, rest;
+		words >> desc >> value;
+
+		if (value.empty() || (words >> rest))
 		{
-			complete = true;
-			silhouette = false;
+			std::cerr << "\nError: invalid tuned file" << std::endl << "Each line of file should be of the form : description: value\n\n";
+			return false;
 		}
-		else if (!strcmp(argv[12], "-silhouette"))
+
+		if (desc == "algorithm:")
+			algorithm = value;
+		else if (desc == "metric:")
+			metric = value;
+		else if (desc == "grid_delta:")
 		{
-			complete = false;
-			silhouette = true;
+			delta = atof(value.c_str());
+			if (delta <= 0)
+			{
+				std::cerr << "\nError: invalid tuned file" << std::endl << "grid_delta should be a positive real number\n\n";
+				return false;
+			}
 		}
 		else
 		{
-			std::cerr << "\nError: Expected -complete or -silhouette" << std::endl << "Use : -i -c -o -update -assignment -complete <optional> -silhouette <optional>\n\n";
-			return false;
+			// all other parameters are positive integers
+			if (!is_integer(value.c_str()) || !atoi(value.c_str()))
+			{
+				std::cerr << "\nError: invalid tuned file" << std::endl << desc << " should be a positive integer\n\n";
+				return false;
+			}
+
+			if (desc == "number_of_vector_hash_tables:")
+				L = atoi(value.c_str());
+			else if (desc == "number_of_vector_hash_functions:")
+				k = atoi(value.c_str());
+			else if (desc == "number_of_hypercube_dimensions:")
+				d1 = atoi(value.c_str());
+			else if (desc == "max_number_M_hypercube:")
+				M = atoi(value.c_str());
+			else if (desc == "number_of_probes:")
+				probes = atoi(value.c_str());
+			else if (desc == "window:")
+				w = atoi(value.c_str());
+			else
+			{
+				std::cerr << "\nError: invalid tuned file" << std::endl << "description " << desc << " not valid\n\n";
+				return false;
+			}
 		}
 	}
-	else if (argc == 14)
-	{
-		if (strcmp(argv[12], "-complete") != 0 || strcmp(argv[13], "-silhouette") != 0)
-		{
-			std::cerr << "\nError: Expected -complete and then -silhouette" << std::endl << "Use : -i -c -o -update -assignment -complete <optional> -silhouette <optional>\n\n";
-			return false;
-		}
 
-		complete = true;
-		silhouette = true;
-	}
-	else
+	if (algorithm != "LSH" && algorithm != "Hypercube" && algorithm != "Frechet")
+	{
+		std::cerr << "\nError: invalid tuned file" << std::endl << "File should have a line : algorithm: <LSH / Hypercube / Frechet>\n\n";
 		return false;
+	}
 
 	return true;
 }
-
@@ -31,9 +31,15 @@ bool read_input_file(std::string & input_file, int & n, int & d);
 
 // checks for correct input args from terminal and initializes program parameters if so (for curve search)
 bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & query_file, int & k, int & d1, int & L, int & M, int & probes, 
-	std::string & output_file, std::string & algorithm, std::string & metric, double & delta);
+	std::string & output_file, std::string & algorithm, std::string & metric, double & delta, std::string & server, std::string & load_index, std::string & save_index, std::string & delta_file, long long & seed, std::string & probe_order, std::string & tune_file, std::string & tuned_file, double & bucket_load,
+	int & max_distances, int & max_probes, double & deadline_ms, int & threads);
 
 // checks for correct input args from terminal and initializes program parameters if so (for clustering)
-bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & config_file, std::string & output_file, std::string & update_method, std::string & assignment_method, bool& complete, bool& silhouette);
+bool check_init_args(int argc, const char ** argv, std::string & input_file, std::string & config_file, std::string & output_file, std::string & update_method, std::string & assignment_method, bool& complete, bool& silhouette, long long & seed, std::string & tuned_file, int & threads,
+	int & batch_size, int & batch_iterations, bool & full_assignment, std::string & init_method, double & oversampling);
+
+// reads a tuned configuration file (written by search -tune), each line is "description: value" and lines starting with # are comments
+// returns the algorithm and metric the parameters were tuned for, and sets the parameters found in the file (the rest are left as they are)
+bool read_tuned_file(const std::string & tuned_file, std::string & algorithm, std::string & metric, int & k, int & L, int & d1, int & M, int & probes, int & w, double & delta);
 
 #endif
\ No newline at end of file
@@ -10,36 +10,24 @@
 #include <utility>
 #include <typeinfo>
 #include <list>
-#include <stdlib.h>     /* srand, rand */
+#include <limits>
+#include <algorithm>
 
 
 /////////////////////////////// CLASS OBJECT ///////////////////////////////////////////
 
 ///////////////////////// CONSTRUCTION / DESTRUCTION ///////////////////////////////////
 
-Object::Object()
+Object::Object(rng & generator, int dim)
 {
 	float norm_squared = 0.0;
-	int dim = 0;
-	
-	// different Object size depending on algorithm
-	if (algorithm == "LSH" || algorithm == "Hypercube")
-		dim = d;
-	else if (algorithm == "Frechet" && metric_func == "discrete")
-		dim = 2*d;
-	else if (algorithm == "Frechet" && metric_func == "continuous")
-		dim = d;
 
-	for (int i = 0; i < dim; ++i)
-	{
-		std::random_device rd;
-		std::mt19937 generator(rd());
-		std::normal_distribution<float> distr(0, 1);		// each coordinate follows normal(0,1) distribution
-
-		data_vector.push_back(distr(generator));
+	// each coordinate follows normal(0,1) distribution, all coordinates are drawn at once
+	data_vector.resize(dim);
+	generator.gaussian(data_vector.data(), dim);
 
+	for (int i = 0; i < dim; ++i)
 		norm_squared += data_vector[i] * data_vector[i];
-	}
 
 	for (int i = 0; i < dim; ++i)
 		data_vector[i] = data_vector[i] / sqrt(norm_squared);			// divide each coordinate by norm, to normalize point-object
@@ -58,6 +46,8 @@ Object::Object(std::vector <float> & input_vector)
 }
 
 
+Object::Object(const float * coordinates, int dim) : data_vector(coordinates, coordinates + dim) {}
+
 Object::~Object() {}
 
 ///////////////////////// GETTERS /////////////////////////////////////////////
@@ -173,7 +163,30 @@ double Object::euclidean_distance(const Abstract_Object & abstract_object) const
 	//	std::cerr << "Object::euclidean_distance : Bad_Cast error --> " << error.what() << std::endl << std::endl;
 	//}
 
+	return this->euclidean_distance(p);
+}
+
+double Object::euclidean_distance(const Object & p) const
+{
+	double dist_squared = 0.0;
+
+	if (this->get_dim() != p.get_dim())		// object dimensions should match for euclidean distance
+	{
+		std::cerr << "Warning : Object::euclidean_distance : dimensions don't match\n\n";
+		return dist_squared;		//  returns garbage value
+	}
+
+	for (int i = 0; i < this->get_dim(); ++i)
+		dist_squared += (double) (this->data_vector[i] - p.data_vector[i]) * (double) (this->data_vector[i] - p.data_vector[i]);
+
+	return sqrt(dist_squared);
+}
+
+double Object::euclidean_distance(const Object & p, double bound) const
+{
 	double dist_squared = 0.0;
+	// (with a small margin over the rounding of bound * bound, so that a distance equal to bound is never abandoned)
+	double bound_squared = bound * bound * (1 + 1e-9);
 
 	if (this->get_dim() != p.get_dim())		// object dimensions should match for euclidean distance
 	{
@@ -182,7 +195,11 @@ double Object::euclidean_distance(const Abstract_Object & abstract_object) const
 	}
 
 	for (int i = 0; i < this->get_dim(); ++i)
+	{
 		dist_squared += (double) (this->data_vector[i] - p.data_vector[i]) * (double) (this->data_vector[i] - p.data_vector[i]);
+		if (dist_squared > bound_squared)		// the partial sums only grow, abandon (the partial distance is still a lower bound of the distance)
+			return sqrt(dist_squared);
+	}
 
 	return sqrt(dist_squared);
 }
@@ -198,6 +215,11 @@ double Object::discrete_frechet_distance(const Abstract_Object & abstract_object
 	//	std::cerr << "time_series::discrete_frechet_distance : Bad_Cast error --> " << error.what() << std::endl << std::endl;
 	//}
 
+	return this->discrete_frechet_distance(P);
+}
+
+double Object::discrete_frechet_distance(const Object & P) const
+{
 	// a vector of vectors that will serve as the 2D array for dynamic programming
 	std::vector <std::vector <double> > OPT(this->get_dim(), std::vector <double> (P.get_dim()));
 	// initialize first square at (0,0)
@@ -229,7 +251,7 @@ const Object * Object::to_Object() const
 }	
 
 
-std::vector <int> Object::snap(const std::vector<double>& t) const
+std::vector <int> Object::snap(const std::vector<double>& t, double delta) const
 {
 	std::vector <int> snapped_object;
 
@@ -301,35 +323,27 @@ std::vector <float> Object::get_extrema(std::vector <int> & snapped_curve_no_dup
 
 }
 
-void Object::pad(std::vector <float> & grid_curve) const
+void Object::pad(std::vector <float> & grid_curve, int complexity) const
 {
 	// finally check if dimension of snapped grid object diminished, and apply padding if necessary
 	// with special big padding number
 	unsigned long int M = 1000000;  /// further testing required
 
-	int size = 0;
-
-	//If the algorithm is continuous frechet, then size = this-.get_dim()
-	// is not reliable because all curves are filtered and thus will have different
-	// complexity. d is a global variable which tells which is the original complexity of the curves
-	if (algorithm == "Frechet" && metric_func == "continuous"){
-		size = d;
-	}
-	else{
-		size = this->get_dim();
-	}
+	// size = this->get_dim() is not reliable because all curves are filtered and thus will have different
+	// complexity, so curves are padded up to the original complexity of the curves, given by the grid
+	int size = complexity;
 
 	for (int i = (int) grid_curve.size(); i < size; ++i)
 		grid_curve.push_back(M);
 }
 
-Abstract_Object * Object::to_grid_curve(const std::vector<double>& t) const
+Abstract_Object * Object::to_grid_curve(const std::vector<double>& t, double delta, int complexity) const
 {
 	// first of all the function snaps the caller Object-time series to grid, without multiplying by delta or shifting by t
 	// we do this so that we can remove duplicate points from snapping by comparing integers (otherwise we would compare floats , oof)
 	
 	// vector holds snapped points-coordinates
-	std::vector <int> snapped_object = this->snap(t);
+	std::vector <int> snapped_object = this->snap(t, delta);
 
 	// vector of grid curve coordinates after removing duplicates from snapping
 	std::vector <int> grid_curve_temp = this->remove_dupls(snapped_object);
@@ -341,7 +355,7 @@ Abstract_Object * Object::to_grid_curve(const std::vector<double>& t) const
 	for (int i = 0; i < (int) grid_curve.size(); ++i)
 		grid_curve[i] = grid_curve[i] * delta + t[0];
 	// do padding necessary
-	this->pad(grid_curve);
+	this->pad(grid_curve, complexity);
 
 	// return the new Object-grid_curve-time_series
 	return new Object(grid_curve);
@@ -490,6 +504,11 @@ double time_series::discrete_frechet_distance(const Abstract_Object & abstract_o
 	//	std::cerr << "time_series::discrete_frechet_distance : Bad_Cast error --> " << error.what() << std::endl << std::endl;
 	//}
 
+	return this->discrete_frechet_distance(P);
+}
+
+double time_series::discrete_frechet_distance(const time_series & P) const
+{
 	// a vector of vectors that will serve as the 2D array for dynamic programming
 	std::vector <std::vector <double> > OPT(this->get_complexity(), std::vector <double> (P.get_complexity()));
 	// initialize first square at (0,0)
@@ -510,6 +529,37 @@ double time_series::discrete_frechet_distance(const Abstract_Object & abstract_o
 	return OPT[this->get_complexity() - 1][P.get_complexity() - 1];	// value for frechet distance is at top right corner of array
 }
 
+double time_series::discrete_frechet_distance(const time_series & P, double bound) const
+{
+	// only the previous row of the array is needed to fill the current one
+	std::vector <double> previous(P.get_complexity()), current(P.get_complexity());
+	// initialize first row of array
+	previous[0] = norm(this->get_ith(0), P.get_ith(0));
+	for (int j = 1; j < P.get_complexity(); j++)
+		previous[j] = std::max(previous[j-1], norm(this->get_ith(0), P.get_ith(j)));
+
+	if (previous[0] > bound)		// the first row is non decreasing, previous[0] is its minimum
+		return previous[0];
+
+	for (int i = 1; i < this->get_complexity(); i++)
+	{
+		current[0] = std::max(previous[0], norm(this->get_ith(i), P.get_ith(0)));
+		double row_min = current[0];
+		for (int j = 1; j < P.get_complexity(); j++)
+		{
+			current[j] = std::max(std::min(previous[j], std::min(previous[j-1], current[j-1])), norm(this->get_ith(i), P.get_ith(j)));
+			row_min = std::min(row_min, current[j]);
+		}
+
+		if (row_min > bound)		// distance exceeds bound, abandon (row_min is still a lower bound of the distance)
+			return row_min;
+
+		previous.swap(current);
+	}
+
+	return previous[P.get_complexity() - 1];
+}
+
 const Object * time_series::to_Object() const
 {
 	std::vector <float> flattened_time_series;
@@ -523,7 +573,7 @@ const Object * time_series::to_Object() const
 	return new Object(flattened_time_series);
 }
 
-std::vector <std::pair <int, int> > time_series::snap(const std::vector<double>& t) const
+std::vector <std::pair <int, int> > time_series::snap(const std::vector<double>& t, double delta) const
 {
 	std::vector <std::pair <int, int> > snapped_time_series;
 
@@ -581,13 +631,13 @@ void time_series::pad(std::vector <std::pair <float, float> > & grid_curve) cons
 }
 
 
-Abstract_Object * time_series::to_grid_curve(const std::vector<double> & t) const
+Abstract_Object * time_series::to_grid_curve(const std::vector<double> & t, double delta, int complexity) const
 {
 	// first of all the function snaps the given time series to grid, without multiplying by delta or shifting by t
 	// we do this so that we can remove duplicate points from snapping by comparing integers (otherwise we would compare floats , oof)
 	
 	// vector holds snapped points-coordinates
-	std::vector <std::pair <int, int> > snapped_time_series = this->snap(t);
+	std::vector <std::pair <int, int> > snapped_time_series = this->snap(t, delta);
 
 	// vector of grid curve coordinates after removing duplicates from snapping
 	std::vector <std::pair <float, float> > grid_curve = this->remove_dupls(snapped_time_series);
@@ -616,73 +666,78 @@ int argmin(T x, T y, T z){
 	return pos;
 }
 
-std::list<std::pair<int, int> > time_series::best_traversal(const time_series* P) const{
-	// a vector of vectors that will serve as the 2D array for dynamic programming
-	std::vector <std::vector <double> > OPT(this->get_complexity(), std::vector <double> (P->get_complexity()));
-	// initialize first square at (0,0)
-	OPT[0][0] = norm(this->get_ith(0), P->get_ith(0));
-	// initialize first column of array
-	for (int i = 1; i < this->get_complexity(); i++)
-		OPT[i][0] = std::max(OPT[i-1][0], norm(this->get_ith(i), P->get_ith(0)));
-	// initialize first row of array
-	for (int j = 1; j < P->get_complexity(); j++)
-		OPT[0][j] = std::max(OPT[0][j-1], norm(this->get_ith(0), P->get_ith(j)));
-
-	// initialize rest of array (i > 0 and j > 0)
-	for (int i = 1; i < this->get_complexity(); i++)
-		for (int j = 1; j < P->get_complexity(); j++)
-			OPT[i][j] = std::max(std::min(OPT[i-1][j], std::min(OPT[i-1][j-1], OPT[i][j-1])), norm(this->get_ith(i), P->get_ith(j)));
-
+// backtracking steps of the best traversal, stored in 2 bits per cell of the dp array
+#define STEP_UP 0		// (i-1, j)
+#define STEP_LEFT 1		// (i, j-1)
+#define STEP_DIAGONAL 2	// (i-1, j-1)
 
-	std::list <std::pair <int, int> > best_traversal;
-	
-	// backtrack on OPT array to compute the best traversal
-	int i = this->get_complexity() - 1;
-	int j = P->get_complexity() - 1;
+std::vector<std::pair<int, int> > time_series::best_traversal(const time_series* P) const{
+	int n = this->get_complexity();
+	int m = P->get_complexity();
 
-	// last point of each curve is definitely part (endpoint actually) of best traversal
-	best_traversal.push_front(std::make_pair(i, j));
+	// the dp array is computed row by row, keeping only the previous and the current row
+	// for each cell the argmin step towards its predecessor is recorded, 4 cells per byte
+	std::vector <double> previous(m), current(m);
+	std::vector <uint8_t> steps(((size_t) n * m + 3) / 4, 0);
+	auto set_step = [&steps, m](int i, int j, int step) {
+		size_t cell = (size_t) i * m + j;
+		steps[cell >> 2] |= step << ((cell & 3) << 1);
+	};
 
-	// while we have not reached starting point for either curves
-	while(i != 0 && j != 0)
+	// initialize first row of array (first square at (0,0), every other square steps left)
+	previous[0] = norm(this->get_ith(0), P->get_ith(0));
+	for (int j = 1; j < m; j++)
 	{
-		int min_index = argmin(OPT[i-1][j], OPT[i][j-1], OPT[i-1][j-1]);
-		if (min_index == 0)
-			best_traversal.push_front(std::make_pair(--i, j));
-		else if (min_index == 1)
-			best_traversal.push_front(std::make_pair(i, --j));
-		else
-			best_traversal.push_front(std::make_pair(--i, --j));
+		previous[j] = std::max(previous[j-1], norm(this->get_ith(0), P->get_ith(j)));
+		set_step(0, j, STEP_LEFT);
 	}
 
-	// complete traversal by adding pair of points until we reach starting point for both curves
-	if (i == 0 && j != 0)	// if we have reached starting point for first curve but not for second curve
+	for (int i = 1; i < n; i++)
 	{
-		while(j != 0)
+		// first column of array steps up
+		current[0] = std::max(previous[0], norm(this->get_ith(i), P->get_ith(0)));
+		set_step(i, 0, STEP_UP);
+
+		// rest of row (j > 0)
+		for (int j = 1; j < m; j++)
 		{
-			// complete traversal by adding points of second curve
-			best_traversal.push_front(std::make_pair(i, --j));
+			int step = argmin(previous[j], current[j-1], previous[j-1]);
+			double predecessor = (step == STEP_UP) ? previous[j] : ((step == STEP_LEFT) ? current[j-1] : previous[j-1]);
+			current[j] = std::max(predecessor, norm(this->get_ith(i), P->get_ith(j)));
+			set_step(i, j, step);
 		}
+		previous.swap(current);
 	}
-	else if (j == 0 && i != 0)	// else if we have reached starting point for second curve but not for first curve
-	{
-		while(i != 0)
-		{
-			// complete traversal by adding points of first curve
-			best_traversal.push_front(std::make_pair(--i, j));
-		}
 
+	// backtrack on recorded steps to compute the best traversal (from the last pair of points to the first one)
+	std::vector <std::pair <int, int> > best_traversal;
+	best_traversal.reserve(n + m - 1);
+
+	int i = n - 1;
+	int j = m - 1;
+	best_traversal.emplace_back(i, j);
+	while (i != 0 || j != 0)
+	{
+		size_t cell = (size_t) i * m + j;
+		int step = (steps[cell >> 2] >> ((cell & 3) << 1)) & 3;
+		if (step != STEP_LEFT)
+			i--;
+		if (step != STEP_UP)
+			j--;
+		best_traversal.emplace_back(i, j);
 	}
 
+	std::reverse(best_traversal.begin(), best_traversal.end());
 	return best_traversal;
 }
 
 std::vector <std::pair <float, float> > time_series::mean_curve_without_filtering(const time_series * P) const
 {
 	
-	std::list <std::pair <int, int> > best_traversal = this->best_traversal(P);
+	std::vector <std::pair <int, int> > best_traversal = this->best_traversal(P);
 	// compute the mean curve from best traversal
 	std::vector <std::pair <float, float> > mean_curve;
+	mean_curve.reserve(best_traversal.size());
 
 	for (auto const& index_pair : best_traversal)
 	{
@@ -697,28 +752,44 @@ std::vector <std::pair <float, float> > time_series::mean_curve_without_filterin
 }
 
 
-Abstract_Object * time_series::mean_curve(const time_series * P) const
+Abstract_Object * time_series::mean_curve(const time_series * P, rng & generator) const
 {
 	std::vector <std::pair <float, float> > mean_curve = this->mean_curve_without_filtering(P);
 
-	// filter mean_curve points, to decrease its complexity
-	int extra_points = mean_curve.size() - this->get_complexity();
-	// for each excessive point of mean curve
-	for (int i = 0; i < extra_points; ++i)
+	int length = mean_curve.size();
+	int complexity = this->get_complexity();
+	if (length <= complexity)
+		return new time_series(mean_curve);
+
+	// filter mean_curve points in a single pass, to decrease its complexity to that of the caller
+	// extra_points of the length-1 gaps between consecutive points are drawn uniformly (selection sampling),
+	// and each run of consecutive drawn gaps merges its points into their mean point
+	int extra_points = length - complexity;
+	std::vector <std::pair <float, float> > filtered;
+	filtered.reserve(complexity);
+
+	double x_sum = mean_curve[0].first, y_sum = mean_curve[0].second;
+	int merged = 1;		// points summed into the current mean point
+	for (int gap = 0; gap < length - 1; ++gap)
 	{
-		// pick a random non-last point index of mean-curve
-		int index = rand() % (mean_curve.size()-1);
-		// find mean point of point at index, index+1
-		float x_value = (std::get<0>(mean_curve[index]) + std::get<0>(mean_curve[index+1])) / 2;
-		float y_value = (std::get<1>(mean_curve[index]) + std::get<1>(mean_curve[index+1])) / 2;
-		// replace the 2 consecutive points with the mean point, reducing mean curves complexity by one
-		mean_curve.erase(mean_curve.begin()+index+1);
-		mean_curve[index].first = x_value;
-		mean_curve[index].second = y_value;
+		// gap (between points gap, gap+1) is drawn with probability extra_points left / gaps left
+		if (generator.uniform() * (length - 1 - gap) < extra_points)
+		{
+			extra_points--;
+			merged++;
+		}
+		else
+		{
+			filtered.emplace_back(x_sum / merged, y_sum / merged);
+			x_sum = y_sum = 0.0;
+			merged = 1;
+		}
+		x_sum += mean_curve[gap+1].first;
+		y_sum += mean_curve[gap+1].second;
 	}
+	filtered.emplace_back(x_sum / merged, y_sum / merged);
 
-
-	return new time_series(mean_curve);
+	return new time_series(filtered);
 }
 
 // metric wrappers
@@ -743,14 +814,14 @@ double norm(const std::pair <float, float> & point1, const std::pair <float, flo
 }
 
 // mean curve wrapper
-Abstract_Object * mean_curve(const Abstract_Object * abstract_object1, const Abstract_Object * abstract_object2)
+Abstract_Object * mean_curve(const Abstract_Object * abstract_object1, const Abstract_Object * abstract_object2, rng & generator)
 {
 	if (abstract_object2 == nullptr)
 		return new time_series(*abstract_object1);
 
-	// downcast abstract objects to type time_series
-	const time_series * P = dynamic_cast<const time_series *>(abstract_object1);
-	const time_series * Q = dynamic_cast<const time_series *>(abstract_object2);
+	// downcast abstract objects to type time_series (mean curves are only computed for clusters of time series)
+	const time_series * P = static_cast<const time_series *>(abstract_object1);
+	const time_series * Q = static_cast<const time_series *>(abstract_object2);
 
-	return P->mean_curve(Q);
+	return P->mean_curve(Q, generator);
 }
\ No newline at end of file
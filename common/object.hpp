@@ -7,8 +7,10 @@
 #include <vector>
 #include <list>
 #include "params.hpp"
+#include "rng.hpp"
 
 class Object;
+class time_series;
 
 /////////////////////////////////////// CLASS ABSTRACT_OBJECT //////////////////////////////////////////////////////////////////////
 
@@ -20,14 +22,20 @@ class Abstract_Object
 protected:
 	// the object identifier name, as read from input file
 	std::string identifier;
+	// the object index in its dataset (-1 for objects not part of a dataset, e.g. query objects or centroids)
+	int id;
 	// default class constructor (does nothing)
-	Abstract_Object() {}
+	Abstract_Object() : id(-1) {}
 	// class constructor, just initializes the object identifier name
-	Abstract_Object(std::string & object_name) : identifier(object_name) {}
+	Abstract_Object(std::string & object_name) : identifier(object_name), id(-1) {}
 
 public:
 	// name identifier getter
 	const std::string & get_name() const { return this->identifier; }
+	// dataset index getter
+	int get_id() const { return this->id; }
+	// dataset index setter
+	void set_id(int index) { this->id = index; }
 
 	// print object
 	virtual void print() const = 0;
@@ -50,8 +58,9 @@ public:
 	// converts caller Abstract Object to an object of type Object
 	virtual const Object * to_Object() const = 0;
 
-	// converts caller Abstract Object to grid curve
-	virtual Abstract_Object * to_grid_curve(const std::vector<double>& t) const = 0;
+	// converts caller Abstract Object to grid curve, of grid with cells of size delta shifted by t
+	// grid curves of filtered curves are padded up to given complexity
+	virtual Abstract_Object * to_grid_curve(const std::vector<double>& t, double delta, int complexity) const = 0;
 	
 };
 
@@ -60,8 +69,9 @@ public:
 // class Object represents a multidimensional point basically
 // class Object holds the data of the input objects-points of the dataset
 // i.e. the coordinates in a d-vector and the object name, from input file
+// Object is final, so calls through an Object reference are resolved at compile time (see strategies.hpp)
 
-class Object : public Abstract_Object
+class Object final : public Abstract_Object
 {
 private:
 	std::vector <float>  data_vector;	// the coordinates of the d-dimensional point-object in an array
@@ -69,12 +79,14 @@ private:
 public:
 	///////////////////////// CONSTRUCTION / DESTRUCTION //////////////////////////////////////////////////////////////////
 	
-	// default constructor creates a random normalized d-dimensional point-object, each coordinate follows normal(0,1) distribution 
-	Object();
+	// constructor creates a random normalized dim-dimensional point-object, each coordinate follows normal(0,1) distribution (drawn from given generator)
+	Object(rng & generator, int dim);
 	// constructor through another d-dimensional input array
 	Object(std::vector <float> & input_vector, std::string & object_name);
 	// constructor through another d-dimensional input array with empty object name
 	Object(std::vector <float> & input_vector);
+	// constructor through a raw array of dim coordinates with empty object name
+	Object(const float * coordinates, int dim);
 	// destructor
 	~Object();
 
@@ -107,31 +119,37 @@ public:
 	
 	// calculates the inner-product of calling object with given object p (both d-dimensional)
 	float inner_prod(const Object& p) const;
-	// calculates the euclidean distance between caller object and argument object
+	// calculates the euclidean distance between caller object and argument object (argument should be an Object)
 	double euclidean_distance(const Abstract_Object & abstract_object) const;
-	// computes the discrete frechet distance between caller object and argument object
+	// calculates the euclidean distance between caller object and argument object, with no downcast
+	double euclidean_distance(const Object & p) const;
+	// same, but stops as soon as the distance is known to exceed bound, and returns the partial distance then (above bound, below the distance)
+	double euclidean_distance(const Object & p, double bound) const;
+	// computes the discrete frechet distance between caller object and argument object (argument should be an Object)
 	double discrete_frechet_distance(const Abstract_Object & abstract_object) const;
+	// computes the discrete frechet distance between caller object and argument object, with no downcast
+	double discrete_frechet_distance(const Object & P) const;
 	// converts caller object to an object of type Object
 	const Object * to_Object() const;
 	
 	//In case of continuous frechet, 
 	std::vector <int>* filtering(const Object& obj) const;
 	// returns a vector with snapped coordinates to grid integers
-	std::vector <int> snap(const std::vector<double>& t) const;
+	std::vector <int> snap(const std::vector<double>& t, double delta) const;
 	// returns a vector with snapped coordinates to grid integers after removing duplicates
 	std::vector <int> remove_dupls(std::vector <int> & snapped_curve) const;
 	// Get extrema
 	std::vector <float> get_extrema(std::vector <int> & snapped_curve_no_dupl) const;
-	// pads given vector of grid coordinates if necessary
-	void pad(std::vector <float> & grid_curve) const;
+	// pads given vector of grid coordinates up to given complexity if necessary
+	void pad(std::vector <float> & grid_curve, int complexity) const;
 	// converts caller Abstract Object to grid curve
-	Abstract_Object * to_grid_curve(const std::vector<double>& t) const;
+	Abstract_Object * to_grid_curve(const std::vector<double>& t, double delta, int complexity) const;
 
 };
 
 
 // class for a 2D time_series object.  We treat a 2D time_series object as a vector of pairs (x,y) values
-class time_series : public Abstract_Object
+class time_series final : public Abstract_Object
 {
 private:
 	std::vector <std::pair <float, float> > data_vector;	// vector of pairs (x,y) x --> time, y -> curve value
@@ -170,35 +188,45 @@ public:
 	/////////////////////// TIME_SERIES OPERATIONS ///////////////////////////////////////////
 
 	double euclidean_distance(const Abstract_Object& abstract_object) const;
-	// computes the discrete frechet distance between caller object and argument object
+	// computes the discrete frechet distance between caller object and argument object (argument should be a time_series)
 	double discrete_frechet_distance(const Abstract_Object & abstract_object) const;
+	// computes the discrete frechet distance between caller object and argument object, with no downcast
+	double discrete_frechet_distance(const time_series & P) const;
+	// same, but abandons the dynamic programming as soon as the distance is known to exceed bound, and returns the minimum of the last row then
+	// (every coupling crosses each row of the array, so the distance is at least that minimum, and exceeds bound once a whole row does)
+	double discrete_frechet_distance(const time_series & P, double bound) const;
 	const Object * to_Object() const;
 	
 	// returns a vector with snapped points to grid integers
-	std::vector <std::pair <int, int> > snap(const std::vector<double>& t) const;
+	std::vector <std::pair <int, int> > snap(const std::vector<double>& t, double delta) const;
 	// returns a vector with snapped points to grid integers after removing duplicates
 	std::vector <std::pair <float, float> > remove_dupls(std::vector <std::pair <int, int> > & snapped_curve) const;
 	// pads given vector of grid points if necessary
 	void pad(std::vector <std::pair <float, float> > & grid_curve) const;
-  	Abstract_Object * to_grid_curve(const std::vector<double>& t) const;
+	// converts caller time series to grid curve (padded up to its own complexity)
+  	Abstract_Object * to_grid_curve(const std::vector<double>& t, double delta, int complexity) const;
 	
-	std::list<std::pair<int, int> > best_traversal(const time_series* P) const;
+	// returns the best traversal of caller and argument time series (pairs of point indices, in order)
+	// the discrete frechet dp array is computed in two rows, keeping only the 2-bit backtracking step of each cell
+	std::vector<std::pair<int, int> > best_traversal(const time_series* P) const;
 
 	std::vector <std::pair <float, float> > mean_curve_without_filtering(const time_series * P) const;
 
 	// calculates optimal traversal through backtracking from discrete frechet dp array
 	// then uses the optimal traversal to return the mean curve of caller and argument time series
-	Abstract_Object * mean_curve(const time_series * P) const;
+	// (the consecutive points merged to bring the mean curve back to the caller's complexity are drawn from given generator, in a single pass)
+	Abstract_Object * mean_curve(const time_series * P, rng & generator) const;
 
 };
 
 
-// metric wrappers
+// metric wrappers, for objects of any type (a virtual call and a downcast per distance)
+// the search structures use the typed metrics of their strategy instead (see strategies.hpp)
 double euclidean(const Abstract_Object & p, const Abstract_Object & q);
 double discrete_frechet(const Abstract_Object & P, const Abstract_Object & Q);
 double norm(const std::pair <float, float> & point1, const std::pair <float, float> & point2);
 
 // mean curve wrapper
-Abstract_Object * mean_curve(const Abstract_Object * abstract_object1, const Abstract_Object * abstract_object2);
+Abstract_Object * mean_curve(const Abstract_Object * abstract_object1, const Abstract_Object * abstract_object2, rng & generator);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,25 @@
+//file:parallel.cpp//
+#include <thread>
+#include <algorithm>
+#include "parallel.hpp"
+
+// 0 until set, the number of hardware threads is used then
+static int num_threads = 0;
+
+void set_num_threads(int threads)
+{
+	num_threads = std::max(threads, 1);
+}
+
+int get_num_threads()
+{
+	if (num_threads > 0)
+		return num_threads;
+
+	return std::max((int) std::thread::hardware_concurrency(), 1);
+}
+
+int parallel_threads(int n, int min_chunk)
+{
+	return std::max(1, std::min(get_num_threads(), n / std::max(min_chunk, 1)));
+}
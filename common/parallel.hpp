@@ -0,0 +1,39 @@
+//file:parallel.hpp//
+#ifndef _PARALLEL_HPP_
+#define _PARALLEL_HPP_
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+// number of threads of the parallel loops of the program (the number of hardware threads, unless set through -threads)
+void set_num_threads(int threads);
+int get_num_threads();
+
+// returns the number of threads a loop of n iterations is split into, so that each thread gets at least min_chunk iterations
+// (cheap iterations, e.g. euclidean distances, need large chunks to pay for starting a thread)
+int parallel_threads(int n, int min_chunk);
+
+// runs f(begin, end, thread) for threads contiguous chunks [begin, end) of [0, n), each in its own thread (chunk 0 in the calling thread)
+// thread is the index of the chunk, so that each chunk can write to its own partial result
+template <typename Function>
+void parallel_for(int n, int threads, Function f)
+{
+	if (threads <= 1)
+	{
+		f(0, n, 0);
+		return;
+	}
+
+	std::vector <std::thread> workers;
+	workers.reserve(threads - 1);
+
+	for (int t = 1; t < threads; ++t)
+		workers.emplace_back(f, (int) ((long long) n * t / threads), (int) ((long long) n * (t + 1) / threads), t);
+
+	f(0, (int) ((long long) n / threads), 0);
+
+	for (std::thread & worker : workers)
+		worker.join();
+}
+
+#endif
@@ -0,0 +1,92 @@
+//file:query_budget.hpp//
+#ifndef _QUERY_BUDGET_HPP_
+#define _QUERY_BUDGET_HPP_
+#include <chrono>
+#include "index_params.hpp"
+
+// the clock is read once every DEADLINE_CHECK_INTERVAL distance evaluations (and once per probe), not for each distance
+#define DEADLINE_CHECK_INTERVAL 16
+
+// class query_budget bounds the work of a single approximate kNN query : distance evaluations, probes (buckets or vertices)
+// and wall clock time, as set in the index parameters (0 for no limit)
+// the search asks the budget before each distance evaluation and each probe, and stops with the neighbors found so far once it is spent
+// a query is truncated only if it is stopped by its budget while it still had objects or probes left to check
+class query_budget
+{
+private:
+	int distances_left;			// distance evaluations left (negative if unlimited)
+	int probes_left;			// probes left (negative if unlimited)
+	bool has_deadline;			// true if the query has a wall clock deadline
+	std::chrono::steady_clock::time_point deadline;
+	int until_check;			// distance evaluations left until the clock is read again
+	bool truncated;				// true once the query was stopped by its budget
+
+	// returns true (and marks the query truncated) if the deadline has passed
+	inline bool expired()
+	{
+		if (this->has_deadline && std::chrono::steady_clock::now() >= this->deadline)
+			this->truncated = true;
+		return this->truncated;
+	}
+
+public:
+	// unlimited budget
+	query_budget() : distances_left(-1), probes_left(-1), has_deadline(false), until_check(DEADLINE_CHECK_INTERVAL), truncated(false) {}
+
+	// budget of the limits in given parameters, the deadline starts counting now
+	explicit query_budget(const index_params & params)
+		: distances_left(params.max_distances > 0 ? params.max_distances : -1), probes_left(params.max_probes > 0 ? params.max_probes : -1),
+		has_deadline(params.deadline_ms > 0), until_check(DEADLINE_CHECK_INTERVAL), truncated(false)
+	{
+		if (this->has_deadline)
+			this->deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration <double, std::milli>(params.deadline_ms));
+	}
+
+	// returns true if one more distance can be evaluated
+	inline bool distance()
+	{
+		if (this->truncated)
+			return false;
+
+		if (this->distances_left == 0)
+		{
+			this->truncated = true;
+			return false;
+		}
+		if (this->distances_left > 0)
+			this->distances_left--;
+
+		if (this->has_deadline && --this->until_check == 0)
+		{
+			this->until_check = DEADLINE_CHECK_INTERVAL;
+			return !this->expired();
+		}
+
+		return true;
+	}
+
+	// returns true if one more bucket (or vertex) can be probed
+	inline bool probe()
+	{
+		if (this->truncated)
+			return false;
+
+		if (this->probes_left == 0)
+		{
+			this->truncated = true;
+			return false;
+		}
+		if (this->probes_left > 0)
+			this->probes_left--;
+
+		return !this->expired();
+	}
+
+	// returns true if the query was stopped by its budget
+	inline bool is_truncated() const
+	{
+		return this->truncated;
+	}
+};
+
+#endif
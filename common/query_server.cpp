@@ -0,0 +1,319 @@
+//file:query_server.cpp//
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <vector>
+#include <list>
+#include <utility>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "query_server.hpp"
+#include "input_check.hpp"
+#include "params.hpp"
+
+// writes the whole buffer to given file descriptor, retrying on partial writes
+static bool write_all(int fd, const std::string & buffer)
+{
+	size_t written = 0;
+
+	while (written < buffer.size())
+	{
+		ssize_t ret = write(fd, buffer.data() + written, buffer.size() - written);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		written += ret;
+	}
+
+	return true;
+}
+
+// splits first space separated word of str into word, and the rest of str into rest
+static void split_word(const std::string & str, std::string & word, std::string & rest)
+{
+	size_t start = str.find_first_not_of(' ');
+	if (start == std::string::npos)
+	{
+		word = "";
+		rest = "";
+		return;
+	}
+
+	size_t end = str.find(' ', start);
+	if (end == std::string::npos)
+	{
+		word = str.substr(start);
+		rest = "";
+		return;
+	}
+
+	word = str.substr(start, end - start);
+	rest = str.substr(end + 1);
+}
+
+query_server::query_server(search_method & method, Dataset & dataset, const int & N)
+	: method(method), dataset(dataset), N(N), running(true) {}
+
+bool query_server::handle_request(const std::string & request, std::string & response)
+{
+	std::string type, args;
+	split_word(request, type, args);
+
+	if (type.empty())		// ignore empty lines
+		return true;
+
+	if (type == "quit")
+		return false;
+	else if (type == "shutdown")
+	{
+		this->running = false;
+		return false;
+	}
+	else if (type == "knn" || type == "range")
+		this->query_request(type, args, response);
+	else if (type == "batch")
+		this->batch_request(args, response);
+	else if (type == "upsert" || type == "remove")
+		this->update_request(type, args, response);
+	else
+		response += "error unknown request " + type + "\n";
+
+	return true;
+}
+
+void query_server::query_request(const std::string & type, const std::string & args, std::string & response)
+{
+	std::string number, object_line;
+	split_word(args, number, object_line);
+
+	if (number.empty() || !is_integer(number.c_str()) || !atoi(number.c_str()))
+	{
+		response += "error " + type + " expects a positive integer\n";
+		return;
+	}
+
+	// object line is of the same form as a line of the input file : name and then the coordinates, tab separated
+	std::string object_name;
+	std::vector <float> input_data;
+
+	if (!Dataset::parse_object_line(object_line, object_name, input_data))
+	{
+		response += "error " + type + " expects a query object\n";
+		return;
+	}
+
+	if ((int) input_data.size() != d)	// query object should have the dimension of the dataset objects
+	{
+		response += "error query object " + object_name + " has wrong dimension\n";
+		return;
+	}
+
+	Abstract_Object * query_object = Dataset::create_object(input_data, object_name);
+	std::ostringstream line;
+	line << type << '\t' << object_name;
+
+	if (type == "knn")
+	{
+		bool truncated = false;
+		std::vector <std::pair <double, const Abstract_Object*> > nearest = this->method.appr_nearest_neighbors(this->dataset, *query_object, atoi(number.c_str()), &truncated);
+
+		line << '\t' << nearest.size();
+		for (auto const& neighbor : nearest)
+			line << '\t' << (std::get<1>(neighbor))->get_name() << '\t' << std::get<0>(neighbor);
+		if (truncated)		// query stopped by its budget, neighbors are the best found until then
+			line << "\ttruncated";
+	}
+	else
+	{
+		std::list <std::pair <double, const Abstract_Object*> > R_list = this->method.range_search(*query_object, atoi(number.c_str()));
+
+		line << '\t' << R_list.size();
+		for (auto const& neighbor : R_list)
+			line << '\t' << (std::get<1>(neighbor))->get_name() << '\t' << std::get<0>(neighbor);
+	}
+
+	line << '\n';
+	response += line.str();
+
+	delete query_object;
+}
+
+void query_server::batch_request(const std::string & args, std::string & response)
+{
+	std::string query_file, output_file, rest;
+	split_word(args, query_file, rest);
+	split_word(rest, output_file, rest);
+
+	if (query_file.empty() || output_file.empty())
+	{
+		response += "error batch expects a query file and an output file\n";
+		return;
+	}
+
+	int nq = 0, dq = 0;
+	// read query file and initialize arguments nq and dq
+	if (!read_input_file(query_file, nq, dq))
+	{
+		response += "error query file " + query_file + " could not be found\n";
+		return;
+	}
+
+	if (dq != d)
+	{
+		response += "error query file " + query_file + " has wrong dimension\n";
+		return;
+	}
+
+	// create a dataset object that will hold all the query objects-points
+	Dataset query_dataset(nq, query_file);
+
+	// execute kNN, range search nearest neighbors algorithms, exactly as in the interactive mode
+	if (!this->method.execute(this->dataset, query_dataset, output_file, this->N, 0))
+	{
+		response += "error output file " + output_file + " could not be opened\n";
+		return;
+	}
+
+	response += "batch\t" + output_file + "\tok\n";
+}
+
+void query_server::update_request(const std::string & type, const std::string & args, std::string & response)
+{
+	if (type == "upsert")
+	{
+		// object line is of the same form as a line of the input file : name and then the coordinates, tab separated
+		if (!upsert_object(args, this->dataset, this->method))
+		{
+			response += "error upsert expects an object of the dataset dimension\n";
+			return;
+		}
+		response += "upsert\t" + args.substr(0, args.find('\t')) + "\tok\n";
+	}
+	else
+	{
+		if (!remove_object(args, this->dataset, this->method))
+		{
+			response += "error object " + args + " could not be found\n";
+			return;
+		}
+		response += "remove\t" + args + "\tok\n";
+	}
+}
+
+bool query_server::serve(int in_fd, int out_fd)
+{
+	std::string pending;		// input read but not yet handled (an incomplete last line)
+	char buffer[65536];
+
+	while (true)
+	{
+		ssize_t bytes = read(in_fd, buffer, sizeof(buffer));
+		if (bytes < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		if (bytes == 0)		// end of input, handle a possible last line without newline
+		{
+			std::string response;
+			if (!pending.empty())
+				this->handle_request(pending, response);
+			return write_all(out_fd, response);
+		}
+
+		pending.append(buffer, bytes);
+
+		// handle all complete request lines read so far, and answer them with a single write
+		// so that pipelined requests get their responses back without a write per request
+		std::string response;
+		size_t start = 0, end;
+		bool open = true;
+
+		while (open && (end = pending.find('\n', start)) != std::string::npos)
+		{
+			std::string request = pending.substr(start, end - start);
+			if (!request.empty() && request[request.size()-1] == '\r')	// remove potential \r character
+				request.erase(request.size()-1);
+
+			open = this->handle_request(request, response);
+			start = end + 1;
+		}
+
+		pending.erase(0, start);
+
+		if (!write_all(out_fd, response))
+			return false;
+
+		if (!open)
+			return true;
+	}
+}
+
+bool query_server::run_stdio()
+{
+	return this->serve(STDIN_FILENO, STDOUT_FILENO);
+}
+
+bool query_server::run_socket(const std::string & socket_path)
+{
+	struct sockaddr_un address;
+
+	if (socket_path.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "\nGiven socket path is too long\n\n";
+		return false;
+	}
+
+	int server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (server_fd < 0)
+	{
+		std::cerr << "\nCould not create server socket\n\n";
+		return false;
+	}
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, socket_path.c_str());
+	unlink(socket_path.c_str());		// remove a stale socket file of a previous run
+
+	if (bind(server_fd, (struct sockaddr *) &address, sizeof(address)) < 0 || listen(server_fd, 8) < 0)
+	{
+		std::cerr << "\nCould not listen on socket " << socket_path << "\n\n";
+		close(server_fd);
+		return false;
+	}
+
+	// a client closing its connection early should not terminate the server
+	signal(SIGPIPE, SIG_IGN);
+
+	std::cerr << "Listening on " << socket_path << std::endl;
+
+	while (this->running)
+	{
+		int client_fd = accept(server_fd, nullptr, nullptr);
+		if (client_fd < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		// serve the client session, a failed session only closes that client's connection
+		this->serve(client_fd, client_fd);
+		close(client_fd);
+	}
+
+	close(server_fd);
+	unlink(socket_path.c_str());
+
+	return !this->running;
+}
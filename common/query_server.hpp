@@ -0,0 +1,55 @@
+//file:query_server.hpp//
+#ifndef _QUERY_SERVER_HPP_
+#define _QUERY_SERVER_HPP_
+#include <iostream>
+#include <string>
+#include "params.hpp"
+#include "dataset.hpp"
+#include "object.hpp"
+#include "search_method.hpp"
+#include "index_update.hpp"
+
+// class query_server keeps an already built search structure (and its dataset) warm in memory
+// and answers query requests read through a line protocol, either on stdin/stdout or on a unix domain socket
+//
+// each request is a single line, and gets a single response line (requests can be pipelined, responses come back in order):
+//	knn <N> <name>\t<x1>\t<x2>...		--> knn <name> <found> <neighbor-1> <distance-1> ... 	(tab separated, ends with truncated if the query budget was reached)
+//	range <R> <name>\t<x1>\t<x2>...		--> range <name> <found> <neighbor-1> <distance-1> ...	(tab separated)
+//	batch <query_file> <output_file>	--> batch <output_file> ok  (runs the whole query file, same output as the interactive mode)
+//	upsert <name>\t<x1>\t<x2>...		--> upsert <name> ok  (inserts the object, or replaces the object with the same name)
+//	remove <name>						--> remove <name> ok
+//	quit								--> closes the session (for stdin/stdout this also stops the server)
+//	shutdown							--> closes the session and stops the server
+// any invalid request gets the response : error <message>
+
+class query_server
+{
+private:
+	search_method & method;		// search structure used for the queries (data already imported)
+	Dataset & dataset;			// input dataset the search structure was built on (and updated by upsert and remove requests)
+	int N;						// number of nearest neighbors for batch requests
+	bool running;				// false once a shutdown request is received
+
+	// handles a single request line and appends its response line to response
+	// returns false if the session should be closed
+	bool handle_request(const std::string & request, std::string & response);
+	// answers a knn or range request for the query object encoded in the rest of the request line
+	void query_request(const std::string & type, const std::string & args, std::string & response);
+	// answers a batch request, i.e. runs the whole query file and writes the results to the output file
+	void batch_request(const std::string & args, std::string & response);
+	// answers an upsert or remove request, i.e. updates dataset and search structure in place
+	void update_request(const std::string & type, const std::string & args, std::string & response);
+	// serves requests read from in_fd and writes responses to out_fd, until the session is closed or end of input
+	bool serve(int in_fd, int out_fd);
+
+public:
+	// constructor, search structure should already have imported the dataset given
+	// (the metric used for the queries is the one the search structure was compiled with)
+	query_server(search_method & method, Dataset & dataset, const int & N);
+	// serves a single session on stdin/stdout
+	bool run_stdio();
+	// listens on a unix domain socket at given path and serves one client session at a time, until a shutdown request
+	bool run_socket(const std::string & socket_path);
+};
+
+#endif
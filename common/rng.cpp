@@ -0,0 +1,73 @@
+//file:rng.cpp//
+#include <iostream>
+#include <cstdint>
+#include <cmath>
+#include <random>
+#include <chrono>
+#include "rng.hpp"
+
+// splitmix64, used to expand a single seed into the 4 words of the state
+static uint64_t splitmix64(uint64_t & x)
+{
+	return mix64(x += 0x9e3779b97f4a7c15ULL);
+}
+
+rng::rng(uint64_t seed)
+{
+	for (int i = 0; i < 4; ++i)
+		this->state[i] = splitmix64(seed);
+}
+
+void rng::jump()
+{
+	static const uint64_t JUMP[] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+
+	uint64_t s[4] = {0, 0, 0, 0};
+
+	for (int i = 0; i < 4; ++i)
+	{
+		for (int b = 0; b < 64; ++b)
+		{
+			if (JUMP[i] & (1ULL << b))
+			{
+				for (int j = 0; j < 4; ++j)
+					s[j] ^= this->state[j];
+			}
+			this->next();
+		}
+	}
+
+	for (int j = 0; j < 4; ++j)
+		this->state[j] = s[j];
+}
+
+void rng::gaussian(float * array, int count)
+{
+	const double two_pi = 2.0 * M_PI;
+
+	for (int i = 0; i < count; i += 2)
+	{
+		double u1 = 1.0 - this->uniform();		// in (0,1], so that log is finite
+		double u2 = this->uniform();
+		double radius = sqrt(-2.0 * log(u1));
+
+		array[i] = radius * cos(two_pi * u2);
+		if (i + 1 < count)
+			array[i+1] = radius * sin(two_pi * u2);
+	}
+}
+
+rng rng::split()
+{
+	rng child = *this;
+	this->jump();
+	return child;
+}
+
+uint64_t random_seed()
+{
+	std::random_device rd;
+	uint64_t seed = ((uint64_t) rd() << 32) ^ rd();
+
+	return seed ^ (uint64_t) std::chrono::high_resolution_clock::now().time_since_epoch().count();
+}
@@ -0,0 +1,78 @@
+//file:rng.hpp//
+#ifndef _RNG_HPP_
+#define _RNG_HPP_
+#include <iostream>
+#include <cstdint>
+#include <limits>
+
+// class rng is the single random generator of the program, used to build every hash function and to initialize the centroids
+// it is a xoshiro256** generator : a few shifts and rotations per number, and a state of 4 words only,
+// so one generator seeded once (instead of a std::random_device and std::mt19937 per coordinate) builds all hash functions
+// split() gives a new generator with a stream that never overlaps with the rest of the caller's stream (jump ahead of 2^128 numbers)
+class rng
+{
+private:
+	uint64_t state[4];		// generator state, never all zero
+
+	static inline uint64_t rotl(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+	// advances the state by 2^128 numbers
+	void jump();
+
+public:
+	// std::uniform_random_bit_generator interface, so that rng can also be used with the std distributions
+	typedef uint64_t result_type;
+	static constexpr uint64_t min() { return 0; }
+	static constexpr uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
+
+	// constructor, expands given seed into the generator state (through splitmix64)
+	explicit rng(uint64_t seed);
+
+	// returns the next 64 random bits
+	inline uint64_t next()
+	{
+		const uint64_t result = rotl(this->state[1] * 5, 7) * 9;
+		const uint64_t t = this->state[1] << 17;
+
+		this->state[2] ^= this->state[0];
+		this->state[3] ^= this->state[1];
+		this->state[1] ^= this->state[2];
+		this->state[0] ^= this->state[3];
+		this->state[2] ^= t;
+		this->state[3] = rotl(this->state[3], 45);
+
+		return result;
+	}
+
+	inline uint64_t operator()() { return this->next(); }
+
+	// returns a double uniformly in [0,1)
+	inline double uniform() { return (this->next() >> 11) * (1.0 / 9007199254740992.0); }		// 53 random bits, divided by 2^53
+	// returns a float uniformly in [lower_bound, upper_bound)
+	inline float uniform(float lower_bound, float upper_bound) { return lower_bound + (upper_bound - lower_bound) * (float) this->uniform(); }
+	// returns an integer uniformly in [lower_bound, upper_bound]
+	inline int uniform_int(int lower_bound, int upper_bound)
+	{
+		uint64_t range = (uint64_t) ((int64_t) upper_bound - lower_bound) + 1;
+		return lower_bound + (int) (((this->next() >> 32) * range) >> 32);
+	}
+
+	// fills given array with count numbers of the normal(0,1) distribution (Box-Muller, two numbers per pair of uniforms)
+	void gaussian(float * array, int count);
+
+	// returns a generator that continues the current stream, and jumps the caller ahead so that the two streams never overlap
+	rng split();
+};
+
+// splitmix64 finalizer : returns a hash of x where every bit of x affects every bit of the result
+inline uint64_t mix64(uint64_t z)
+{
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+// returns a seed for runs where no seed was given (different on every run)
+uint64_t random_seed();
+
+#endif
@@ -5,15 +5,25 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <list>
 #include "params.hpp"
-#include "hash.hpp"
 #include "dataset.hpp"
 #include "object.hpp"
 #include <set>
+#include <cstdint>
+
+// number of buckets (or hypercube vertices) visited by each incremental compaction step, after an index update
+#define COMPACTION_STEP 64
+
+// min number of objects each thread of an exact (brute force) kNN search gets : euclidean distances are cheap,
+// so vectors need large chunks to pay for starting a thread, frechet distances are not
+#define BRUTE_FORCE_CHUNK 4096
+#define BRUTE_FORCE_CURVE_CHUNK 32
 
 // abstract class search_method provides an interface for search.cpp
 // all curve similarity search algorithm classes inherit from this class
 // and override its pure virtual functions
+// the metric of each search structure is fixed at compile time by its strategy type (see strategies.hpp)
 
 class search_method
 {
@@ -24,17 +34,34 @@ public:
 	// imports dataset objects into search struct
 	virtual void import_data(const Dataset & dataset) = 0;
 
-	// executes the approximate/exact/ranged nearest neighbors algorithms using given metric function (pointer to function)
-	virtual bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &)) = 0;
+	// writes the complete built search struct to an index snapshot file, objects are stored as their ids in given dataset
+	virtual bool save_index(const std::string & index_file, const Dataset & dataset) const = 0;
+
+	// inserts a single object into search struct (object should already be inserted in the dataset, so that it has its id)
+	virtual void insert(const Abstract_Object & object) = 0;
+	// removes a single object from search struct, the object is marked as removed at once (tombstone) and searches skip it,
+	// while its entries are compacted away from the buckets a few buckets at a time, by the updates that follow
+	virtual void remove(const Abstract_Object & object) = 0;
+	// compacts away at once all entries of removed objects
+	virtual void compact() = 0;
+
+	// returns the approximate number of bytes taken by the search struct (hash functions and bucket entries, not the dataset objects)
+	virtual uint64_t memory_usage() const = 0;
+	// prints the occupancy statistics of the buckets (or vertices) of the search struct
+	virtual void print_stats(std::ostream & out) const = 0;
+
+	// executes the approximate/exact/ranged nearest neighbors algorithms
+	virtual bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R) = 0;
 
-	// runs approximate nearest neighbors using given metric function and returns an array of nearest neighbors and distances found
-	virtual std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &)) = 0;
+	// runs approximate nearest neighbors and returns an array of nearest neighbors and distances found
+	// the search stops at the query budget of the struct (see query_budget.hpp), truncated is then set to true if given
+	virtual std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, bool * truncated = nullptr) = 0;
 
-	// runs exact nearest neighbors using given metric function and returns an array of nearest neighbors and distances found
-	virtual std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &)) = 0;
+	// runs exact nearest neighbors and returns an array of nearest neighbors and distances found
+	virtual std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N) = 0;
 
-	// runs approximate range search using given metric function 
-	virtual std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &), const int R2 = 0) = 0;
+	// runs approximate range search 
+	virtual std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, const int R2 = 0) = 0;
 	
 };
 
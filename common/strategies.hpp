@@ -0,0 +1,84 @@
+//file:strategies.hpp//
+#ifndef _STRATEGIES_HPP_
+#define _STRATEGIES_HPP_
+#include "object.hpp"
+
+// strategy types are the template parameters of the search structures (lsh_struct, hypercube and their hash tables)
+// a strategy fixes at compile time how objects are hashed and which metric compares them, so the hashing and search loops
+// are compiled separately for each of them, with no check of the algorithm or metric in between
+//
+// every strategy provides :
+//	snaps_to_grid	--> true if objects are snapped to a grid (h_grid) before they are hashed
+//	uses_fred		--> true if exact distances are computed as continuous frechet distances (fred library)
+//	key_dim(dim)	--> dimension of the vectors given to the h hash functions, for objects of dimension (complexity) dim
+//	metric()		--> name of the metric, as given with -metric ("" for vectors)
+//	name()			--> name of the strategy, used in the output files
+//	object_type		--> concrete type of the objects of the structure (Object or time_series)
+//	distance(p, q)	--> metric used to compare two objects of the structure
+//	bounded_distance(p, q, bound)	--> same metric, but may stop early once the distance is known to exceed bound, and return a value above bound then
+//	abandoned_bounds	--> true if the value bounded_distance stops early with is a lower bound of the distance worth keeping as an Elkan bound
+//						(otherwise Elkan's lower bounds are exact distances)
+//
+// objects reach the structures as Abstract_Objects, the strategy casts them statically to object_type
+// and calls the typed (non virtual) metric of that type, so distance computations make no virtual call and no dynamic_cast
+
+// vectors (LSH and Hypercube) : objects are hashed as they are, and compared with the euclidean distance
+struct vector_strategy
+{
+	static const bool snaps_to_grid = false;
+	static const bool uses_fred = false;
+	static const bool abandoned_bounds = false;		// a partial sum stops just above bound, and saves little of the distance
+	static int key_dim(int dim) { return dim; }
+	static const char * metric() { return ""; }
+	static const char * name() { return "Vector"; }
+	typedef Object object_type;
+	static double distance(const Abstract_Object & p, const Abstract_Object & q)
+	{
+		return static_cast<const Object &>(p).euclidean_distance(static_cast<const Object &>(q));
+	}
+	static double bounded_distance(const Abstract_Object & p, const Abstract_Object & q, double bound)
+	{
+		return static_cast<const Object &>(p).euclidean_distance(static_cast<const Object &>(q), bound);
+	}
+};
+
+// curves under the discrete frechet distance : time series are snapped to a 2d grid, and flattened before they are hashed
+struct discrete_frechet_strategy
+{
+	static const bool snaps_to_grid = true;
+	static const bool uses_fred = false;
+	static const bool abandoned_bounds = true;		// an abandoned dynamic programming saves most of the distance
+	static int key_dim(int dim) { return 2 * dim; }
+	static const char * metric() { return "discrete"; }
+	static const char * name() { return "Frechet_Discrete"; }
+	typedef time_series object_type;
+	static double distance(const Abstract_Object & p, const Abstract_Object & q)
+	{
+		return static_cast<const time_series &>(p).discrete_frechet_distance(static_cast<const time_series &>(q));
+	}
+	static double bounded_distance(const Abstract_Object & p, const Abstract_Object & q, double bound)
+	{
+		return static_cast<const time_series &>(p).discrete_frechet_distance(static_cast<const time_series &>(q), bound);
+	}
+};
+
+// curves under the continuous frechet distance : filtered curves are snapped to a 1d grid before they are hashed
+// approximate searches compare the curves with the discrete frechet distance,
+// exact searches compare them with the continuous frechet distance of the fred library
+struct continuous_frechet_strategy
+{
+	static const bool snaps_to_grid = true;
+	static const bool uses_fred = true;
+	static const bool abandoned_bounds = false;
+	static int key_dim(int dim) { return dim; }
+	static const char * metric() { return "continuous"; }
+	static const char * name() { return "Frechet_Continuous"; }
+	typedef Object object_type;
+	static double distance(const Abstract_Object & p, const Abstract_Object & q)
+	{
+		return static_cast<const Object &>(p).discrete_frechet_distance(static_cast<const Object &>(q));
+	}
+	static double bounded_distance(const Abstract_Object & p, const Abstract_Object & q, double bound) { return distance(p, q); }
+};
+
+#endif
@@ -0,0 +1,127 @@
+//file:top_k.hpp//
+#ifndef _TOP_K_HPP_
+#define _TOP_K_HPP_
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <limits>
+#include "object.hpp"
+
+// up to this many neighbors are kept inline, in a sorted array (kNN queries ask for a few neighbors)
+#define TOP_K_INLINE 16
+
+// class top_k keeps the k nearest neighbors found so far by a kNN search, as (distance, object) pairs
+// for k <= TOP_K_INLINE the neighbors are kept sorted in an inline array (a new neighbor is inserted in place, no allocation),
+// for larger k they are kept in a max heap, in a vector allocated once with capacity k (k is only known at run time,
+// so its storage can not be inline, but pushes never allocate after construction)
+// neighbors are ordered by distance and then by object address, so the k kept do not depend on the order they were found in
+// (partial results of different threads can then be merged into the same neighbors as a single pass)
+class top_k
+{
+public:
+	typedef std::pair <double, const Abstract_Object*> neighbor;
+
+private:
+	int capacity;						// k
+	int count;							// neighbors kept so far (inline array only)
+	neighbor items[TOP_K_INLINE];		// neighbors in increasing order (if capacity <= TOP_K_INLINE)
+	std::vector <neighbor> heap;		// max heap of the neighbors (if capacity > TOP_K_INLINE), reserved to capacity by the constructor
+
+	inline bool is_inline() const { return this->capacity <= TOP_K_INLINE; }
+
+public:
+	explicit top_k(int k) : capacity(std::max(k, 0)), count(0)
+	{
+		if (!this->is_inline())
+			this->heap.reserve(this->capacity);
+	}
+
+	// returns number of neighbors kept
+	inline int size() const
+	{
+		return this->is_inline() ? this->count : (int) this->heap.size();
+	}
+
+	// returns true if k neighbors have been found
+	inline bool full() const
+	{
+		return this->size() == this->capacity;
+	}
+
+	// returns the distance of the k-th neighbor found so far (infinity while less than k are found)
+	// an object further than this cannot be one of the k nearest, so its distance computation can be abandoned early
+	inline double bound() const
+	{
+		if (!this->full() || this->capacity == 0)
+			return std::numeric_limits<double>::infinity();
+
+		return this->is_inline() ? this->items[this->count - 1].first : this->heap.front().first;
+	}
+
+	// offers a neighbor, returns true if it is kept (i.e. it is one of the k nearest so far)
+	inline bool push(double dist, const Abstract_Object * object)
+	{
+		neighbor item(dist, object);
+
+		if (this->is_inline())
+		{
+			if (this->count == this->capacity)
+			{
+				if (this->capacity == 0 || !(item < this->items[this->count - 1]))
+					return false;
+				this->count--;		// the current k-th neighbor is dropped
+			}
+
+			// shift the neighbors further than the new one, and insert it in place
+			int i = this->count;
+			while (i > 0 && item < this->items[i - 1])
+			{
+				this->items[i] = this->items[i - 1];
+				i--;
+			}
+			this->items[i] = item;
+			this->count++;
+			return true;
+		}
+
+		if ((int) this->heap.size() == this->capacity)
+		{
+			if (!(item < this->heap.front()))
+				return false;
+			std::pop_heap(this->heap.begin(), this->heap.end());
+			this->heap.pop_back();
+		}
+
+		this->heap.push_back(item);
+		std::push_heap(this->heap.begin(), this->heap.end());
+		return true;
+	}
+
+	// offers all neighbors kept by other (e.g. the partial result of another thread)
+	inline void merge(const top_k & other)
+	{
+		if (other.is_inline())
+		{
+			for (int i = 0; i < other.count; ++i)
+				this->push(other.items[i].first, other.items[i].second);
+		}
+		else
+		{
+			for (auto const& item : other.heap)
+				this->push(item.first, item.second);
+		}
+	}
+
+	// returns the neighbors kept, in increasing distance
+	inline std::vector <neighbor> sorted() const
+	{
+		if (this->is_inline())
+			return std::vector <neighbor>(this->items, this->items + this->count);
+
+		std::vector <neighbor> nearest(this->heap);
+		std::sort_heap(nearest.begin(), nearest.end());
+		return nearest;
+	}
+};
+
+#endif
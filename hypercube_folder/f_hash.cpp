@@ -1,27 +1,47 @@
 #include <cstdlib>
 #include <iostream>
 #include <unordered_map>
-#include <time.h>
+#include <vector>
 #include "f_hash.hpp"
 
 
-f_hash::f_hash() : value_map(){}
+f_hash::f_hash(rng & generator) : seed(generator.next()){}
 
+f_hash::f_hash(index_reader & reader) : seed(reader.read<uint64_t>()){}
 
-	// overload of () operator, so that each h_hash object can be used as a "function"
-uint8_t f_hash::operator()(int p){
-    std::unordered_map<int,uint8_t>::const_iterator it = this->value_map.find(p);
-
-    // int p has not be evaluated by f yet so choose randomlly fromm {0,1} and save that choice
-    if ( it == this->value_map.end() ){
-        return this->value_map[p] = rand() % 2;
-    }    
-    else{
-        return it->second;
-    }
-}	
+void f_hash::save(index_writer & writer) const{
+    writer.write(this->seed);
+}
 // print method for debugging
 //void print();
 
-//No need for a destructor, the unordered map has already a destructor
-f_hash::~f_hash(){}
\ No newline at end of file
+//No need for a destructor
+f_hash::~f_hash(){}
+
+legacy_f_hash::legacy_f_hash(index_reader & reader, rng & generator) : f(generator), legacy_map()
+{
+    // version 1 snapshot : f was stored as the values it had mapped so far
+    uint64_t num_of_keys = 0, num_of_values = 0;
+    const int32_t * keys = reader.read_array<int32_t>(num_of_keys);
+    const uint8_t * values = reader.read_array<uint8_t>(num_of_values);
+
+    if (num_of_keys != num_of_values){
+        reader.fail();
+        return;
+    }
+
+    this->legacy_map.reserve(num_of_keys);
+    for (uint64_t i = 0 ; i < num_of_keys ; i++){
+        this->legacy_map[keys[i]] = values[i];
+    }
+}
+
+uint8_t legacy_f_hash::operator()(int p) const{
+    std::unordered_map<int,uint8_t>::const_iterator it = this->legacy_map.find(p);
+
+    // int p was not evaluated when the snapshot was written, so its bit is taken from the seed
+    if ( it == this->legacy_map.end() ){
+        return this->f(p);
+    }
+    return it->second;
+}
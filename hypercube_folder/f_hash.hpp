@@ -5,24 +5,49 @@
 #include "h_hash.hpp"
 #include "object.hpp"
 #include <unordered_map>
+#include "index_io.hpp"
+#include "rng.hpp"
 
 // class f_hash are functions  which map integers randomly to {0,1} 
+// the bit of an integer is the top bit of a hash of the integer mixed with a random seed, so f needs no state besides its seed
+// and evaluating it never changes it (queries can evaluate it concurrently)
 
 class f_hash{
 
 private:
-	std::unordered_map<int, uint8_t> value_map;  //Evety value given to f will be mapped to 0 or 1 randomly
-                                            //But when a value is evaluated, it is store so that he value will remain the same
-                                            // so that f will act like a function
+	uint64_t seed;                                  //Random seed of the function, drawn from the generator given
 public:
-	// Just initialise the value_map
-	f_hash();
+	// Draws the seed of the function from given generator
+	f_hash(rng & generator);
+	// constructor through an index snapshot (version 2 or later), reads the seed of the function
+	f_hash(index_reader & reader);
+	// writes the seed of the function to an index snapshot
+	void save(index_writer & writer) const;
 	// overload of () operator, so that f_hash can be used as a "function" for integers
-	uint8_t operator()(int p);	
+	uint8_t operator()(int p) const
+	{
+		return mix64(this->seed ^ (uint32_t) p) >> 63;
+	}
 	// print method for debugging
 	//void print() const;
 
     ~f_hash();
 };
 
-#endif
\ No newline at end of file
+// class legacy_f_hash is an f function loaded from a version 1 snapshot, which stored the values f had mapped so far instead of a seed
+// the other values are mapped as f_hash does, with a seed drawn when the snapshot is loaded
+// (a cube holds either d1 f_hash or d1 legacy_f_hash functions, so the f_hash evaluations never check for a legacy map)
+
+class legacy_f_hash{
+
+private:
+	f_hash f;                                       //f of the values not in the map
+	std::unordered_map<int, uint8_t> legacy_map;    //values mapped by f when the snapshot was written
+public:
+	// constructor through a version 1 index snapshot, reads the values mapped (the seed of the other values is drawn from given generator)
+	legacy_f_hash(index_reader & reader, rng & generator);
+	// overload of () operator, so that legacy_f_hash can be used as a "function" for integers
+	uint8_t operator()(int p) const;
+};
+
+#endif
@@ -1,40 +1,413 @@
 #include "hypercube_class.hpp"
+#include "lsh_struct.hpp"
+#include "fred/include/frechet.hpp"
+#include "bucket_stats.hpp"
+#include "top_k.hpp"
+#include "parallel.hpp"
 #include <string>
 #include <chrono>
 #include <queue>
 #include <utility>
 #include <vector>
 #include <fstream>
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <cmath>
+#include <limits>
+
+//Returns all the 2^dim masks of dim bits, in increasing hamming distance from 0 (number of bits set)
+// masks with the same number of bits set are in increasing value, i.e. the order the vertices at the same hamming distance were visited so far
+static std::vector<uint32_t> hamming_ordered_masks(int dim){
+    std::vector<uint32_t> masks;
+    masks.reserve(1 << dim);
+
+    masks.push_back(0);
+    for (int bits = 1 ; bits <= dim ; bits++){
+        //Gosper's hack : walks all masks with the given number of bits set, in increasing value
+        uint32_t mask = (1u << bits) - 1;
+        while (mask < (1u << dim)){
+            masks.push_back(mask);
+            uint32_t lowest = mask & -mask;
+            uint32_t ripple = mask + lowest;
+            mask = ripple | (((mask ^ ripple) >> 2) / lowest);
+        }
+    }
+    return masks;
+}
+
+//Returns hamming_ordered_masks(dim), built once per dim and shared by every cube of that dimension (the table never changes)
+static const std::vector<uint32_t>& shared_hamming_ordered_masks(int dim){
+    static std::map<int, std::vector<uint32_t> > tables;     //map nodes do not move, so the references returned stay valid
+    static std::mutex tables_lock;
+
+    std::lock_guard<std::mutex> guard(tables_lock);
+    auto table_it = tables.find(dim);
+    if (table_it == tables.end())
+        table_it = tables.emplace(dim, hamming_ordered_masks(dim)).first;
+    return table_it->second;
+}
+
+//Sinks that receive the objects found while probing the vertices
+//bound() is the distance past which the sink drops an object, so the distance computation can be abandoned there
+//kNN sink keeps the N nearest objects found so far
+struct knn_sink {
+    top_k nearest;
+
+    knn_sink(int N) : nearest(N) {}
+    double bound() const { return this->nearest.bound(); }
+    void operator()(double dist, const Abstract_Object* obj_p){ this->nearest.push(dist, obj_p); }
+};
+
+//Range search sink keeps the objects which belong to the ring [R2, R) around the query object
+struct range_sink {
+    std::list <std::pair <double, const Abstract_Object*> > R_list;
+    int R, R2;
+
+    range_sink(int R, int R2) : R(R), R2(R2) {}
+    double bound() const { return this->R; }
+    void operator()(double dist, const Abstract_Object* obj_p){
+        if (this->R2 <= dist && dist < this->R)
+            this->R_list.push_back(std::make_pair(dist, obj_p));
+    }
+};
+
+//Probed objects sink keeps every object found, whatever its distance
+struct probed_sink {
+    std::vector <std::pair <double, const Abstract_Object*> > objects;
+
+    double bound() const { return std::numeric_limits<double>::infinity(); }
+    void operator()(double dist, const Abstract_Object* obj_p){ this->objects.emplace_back(dist, obj_p); }
+};
+
+template <typename Strategy>
+hypercube<Strategy>::hypercube(const index_params & params, rng & generator) : params(params),
+    h_delta(Strategy::snaps_to_grid ? H_GRID_DIM : 0, params.delta, params.dim, generator), dead_entries(0), compact_cursor(0){
+    this->build_vertices(std::vector<const Abstract_Object*>(), std::vector<uint32_t>());    //2^d1 empty vertices (d1 is the dimension of the hypercube)
+    this->probe_masks = &shared_hamming_ordered_masks(this->params.d1);
+
+    this->h_array.reserve(this->params.d1);
+    this->f_array.reserve(this->params.d1);
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        this->h_array.emplace_back(generator, Strategy::key_dim(this->params.dim), this->params.w);
+    }
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        this->f_array.emplace_back(generator);
+    }
+}
+
+template <typename Strategy>
+hypercube<Strategy>::hypercube(index_reader & reader, const Dataset & dataset, const index_params & params, rng & generator) : params(params),
+    h_delta(Strategy::snaps_to_grid ? h_grid(reader, params.delta, params.dim, H_GRID_DIM) : h_grid(0, params.delta, params.dim, generator)), dead_entries(0), compact_cursor(0){
+    this->build_vertices(std::vector<const Abstract_Object*>(), std::vector<uint32_t>());
+    this->probe_masks = &shared_hamming_ordered_masks(this->params.d1);
+
+    this->h_array.reserve(this->params.d1);
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        this->h_array.emplace_back(reader, this->params.w);
+    }
+    // a version 1 snapshot stored the f functions as the values they had mapped
+    if (reader.get_version() >= 2){
+        this->f_array.reserve(this->params.d1);
+        for (int j = 0 ; j < this->params.d1 ; j++){
+            this->f_array.emplace_back(reader);
+        }
+    }
+    else{
+        this->legacy_f_array.reserve(this->params.d1);
+        for (int j = 0 ; j < this->params.d1 ; j++){
+            this->legacy_f_array.emplace_back(reader, generator);
+        }
+    }
+
+    // vertices contents are stored as offsets to an array of object ids (vertex i is [offsets[i], offsets[i+1]) )
+    uint64_t num_of_offsets = 0, num_of_ids = 0;
+    const uint32_t * offsets = reader.read_array<uint32_t>(num_of_offsets);
+    const int32_t * ids = reader.read_array<int32_t>(num_of_ids);
+
+    if (!reader.good() || num_of_offsets != (uint64_t) (1 << this->params.d1) + 1 || offsets[0] != 0 || offsets[1 << this->params.d1] != num_of_ids){
+        reader.fail();
+        return;
+    }
+
+    // the snapshot layout is the layout of the vertices in memory, so its arrays are copied as they are
+    for (int i = 0 ; i < (1 << this->params.d1) ; i++){
+        if (offsets[i] > offsets[i+1]){
+            reader.fail();
+            return;
+        }
+    }
+
+    this->vertex_entries.resize(num_of_ids);
+    for (uint64_t j = 0 ; j < num_of_ids ; j++){
+        if (ids[j] < 0 || ids[j] >= dataset.get_num_of_Objects()){   // ids should refer to objects of given dataset
+            reader.fail();
+            return;
+        }
+        this->vertex_entries[j] = &dataset.get_ith_object(ids[j]);
+    }
+
+    this->vertex_offsets.assign(offsets, offsets + num_of_offsets);
+    this->vertex_ends.assign(offsets + 1, offsets + num_of_offsets);
+
+    // fred curves are not part of the snapshot, they are just copies of the dataset objects
+    if (Strategy::uses_fred){
+        for (int i = 0 ; i < dataset.get_num_of_Objects() ; i++){
+            this->curve_vect.push_back(transform_to_Fred_Curve(static_cast<const Object&>(dataset.get_ith_object(i))));
+        }
+    }
+}
+
+template <typename Strategy>
+bool hypercube<Strategy>::save_index(const std::string & index_file, const Dataset & dataset) const{
+    // the f functions of a version 1 snapshot hold only the values they had evaluated, they can not be written as seeds
+    if (!this->legacy_f_array.empty()){
+        std::cerr << "\nHypercube was loaded from a version 1 snapshot, import the input dataset again to save it\n";
+        return false;
+    }
+
+    index_writer writer(index_file);
+
+    if (!writer.is_open())      // check if file was opened properly
+        return false;
+
+    write_index_header(writer, "Hypercube", "Hypercube", Strategy::metric(), dataset.get_num_of_Objects(), this->params);
 
-hypercube::hypercube(){
-    this->cube_array = new std::list<const Abstract_Object*>[1 << d1]; //size 2^k (di is the global variable which stores the dimension of the hypercube)
-    this->f_array = new f_hash[d1];
-    this->h_array = new h_hash[d1];
+    if (Strategy::snaps_to_grid){
+        this->h_delta.save(writer);
+    }
+
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        this->h_array[j].save(writer);
+    }
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        this->f_array[j].save(writer);
+    }
+
+    // flatten vertices into offsets and object ids arrays
+    std::vector<uint32_t> offsets((1 << this->params.d1) + 1, 0);
+    std::vector<int32_t> ids;
+
+    for (int i = 0 ; i < (1 << this->params.d1) ; i++){
+        for (uint32_t j = this->vertex_offsets[i] ; j < this->vertex_ends[i] ; j++){
+            ids.push_back(this->vertex_entries[j]->get_id());
+        }
+        auto overflow_it = this->overflow.find(i);
+        if (overflow_it != this->overflow.end()){
+            for (auto obj_p : overflow_it->second){
+                ids.push_back(obj_p->get_id());
+            }
+        }
+        offsets[i+1] = ids.size();
+    }
+
+    writer.write_array(offsets.data(), offsets.size());
+    writer.write_array(ids.data(), ids.size());
+
+    return writer.good();
 }
 
-uint8_t hypercube::get_0_or_1(int index, const Abstract_Object& abstract_object){
-	// downcast abstract object to type Object (hypercube works with only Objects anyway)
-	const Object& object = dynamic_cast<const Object&>(abstract_object);
-    return (this->f_array[index])(this->h_array[index](object));
+template <typename Strategy>
+template <typename F>
+int hypercube<Strategy>::key_vertex(const Object& key, const std::vector<F>& f) const{
+    int index = 0; //the index holds the encoding of the coordinates of the vertex 
+    for (int j = 0 ; j < this->params.d1 ; j++){
+        index = (index << 1) + f[j](this->h_array[j](key));
+    }
+    return index;
+}
+
+template <typename Strategy>
+const Object* hypercube<Strategy>::hash_key(const Abstract_Object& abstract_object) const{
+    // vectors are projected as they are (the object type of a strategy that does not snap is Object)
+    if (!Strategy::snaps_to_grid)
+        return &static_cast<const Object&>(abstract_object);
+
+    // curves are snapped to the grid first, and their grid curve is projected as a vector
+    const Abstract_Object* grid_curve = this->h_delta(abstract_object);
+    const Object* key = grid_curve->to_Object();
+    delete grid_curve;
+    return key;
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::release_hash_key(const Object* key) const{
+    if (Strategy::snaps_to_grid)
+        delete key;
 }
 
 //For each object, index is which vertex of the hypercube the object will be stored, encoded in the rightmost k digits
 // e.g if index = 0b001011 and k = 5 that means the object will be inserted at the vertex (0,1,0,1,1) where 
 // the 5 rightmost bits are read from left to right
-void hypercube::import_data(const Dataset& dataset){
+template <typename Strategy>
+int hypercube<Strategy>::get_vertex(const Abstract_Object& abstract_object) const{
+    const Object* key = this->hash_key(abstract_object);
+
+    int index = this->legacy_f_array.empty() ? this->key_vertex(*key, this->f_array) : this->key_vertex(*key, this->legacy_f_array);
+
+    this->release_hash_key(key);
+    return index;
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::build_vertices(const std::vector<const Abstract_Object*> & objects, const std::vector<uint32_t> & vertices){
+    const int num_of_vertices = 1 << this->params.d1;
+
+    //count the objects of each vertex, vertex i then starts at the sum of the counts of the vertices before it
+    this->vertex_offsets.assign(num_of_vertices + 1, 0);
+    for (uint32_t vertex : vertices){
+        this->vertex_offsets[vertex + 1]++;
+    }
+    for (int i = 0 ; i < num_of_vertices ; i++){
+        this->vertex_offsets[i + 1] += this->vertex_offsets[i];
+    }
+
+    //place the objects, in their order within each vertex
+    this->vertex_ends.assign(this->vertex_offsets.begin(), this->vertex_offsets.end() - 1);
+    this->vertex_entries.resize(objects.size());
+    for (size_t i = 0 ; i < objects.size() ; i++){
+        this->vertex_entries[this->vertex_ends[vertices[i]]++] = objects[i];
+    }
+
+    this->overflow.clear();
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::import_data(const Dataset& dataset){
     int num_of_objects = dataset.get_num_of_Objects();
+    std::vector<const Abstract_Object*> objects(num_of_objects);
+    std::vector<uint32_t> vertices(num_of_objects);
+
+    //first pass finds the vertex of every object, the second stores them sorted by vertex
     for (int i = 0 ; i < num_of_objects ; i++ ){
-        int index = 0; //the index holds the encoding of the coordinates of the vertex 
-        const Abstract_Object& obj = dataset.get_ith_object(i); //Get the i-th object of the dataset
-        for (int j = 0 ; j < d1 ; j++){
-            index = (index << 1) + this->get_0_or_1(j, obj);
+        objects[i] = &dataset.get_ith_object(i); //Get the i-th object of the dataset
+        vertices[i] = this->get_vertex(*objects[i]);
+        if (Strategy::uses_fred){
+            this->curve_vect.push_back(transform_to_Fred_Curve(static_cast<const Object&>(*objects[i])));
         }
-        this->cube_array[index].push_back(&obj);  //Add the object to the vertex (given by the index) 
+    }
+    this->build_vertices(objects, vertices);
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::insert(const Abstract_Object & object){
+    int vertex = this->get_vertex(object);
+
+    if (Strategy::uses_fred){
+        this->curve_vect.push_back(transform_to_Fred_Curve(static_cast<const Object&>(object)));   //curve_vect is indexed by object id too
+    }
+
+    //objects inserted after the build take a slot freed by the compaction if the vertex has one, otherwise they go to its overflow
+    if (this->vertex_ends[vertex] < this->vertex_offsets[vertex + 1] && this->overflow.count(vertex) == 0)
+        this->vertex_entries[this->vertex_ends[vertex]++] = &object;
+    else
+        this->overflow[vertex].push_back(&object);
+
+    this->compaction_step(COMPACTION_STEP);
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::remove(const Abstract_Object & object){
+    int id = object.get_id();
+
+    if (id < 0 || this->is_removed(object)) //object not in dataset, or already removed
+        return;
+
+    if (id >= (int) this->tombstones.size())
+        this->tombstones.resize(id + 1, false);
+
+    //searches skip the object at once, its entry is erased later on by the compaction steps
+    this->tombstones[id] = true;
+    this->dead_entries++;
+
+    this->compaction_step(COMPACTION_STEP);
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::compact(){
+    this->compaction_step(1 << this->params.d1);
+}
+
+template <typename Strategy>
+uint64_t hypercube<Strategy>::memory_usage() const{
+    uint64_t bytes = this->vertex_entries.capacity() * sizeof(const Abstract_Object*);
+    bytes += (this->vertex_offsets.capacity() + this->vertex_ends.capacity()) * sizeof(uint32_t);     //(the probe masks are shared by the cubes of the same d1)
+    for (auto const& item : this->overflow){
+        bytes += item.second.capacity() * sizeof(const Abstract_Object*);
+    }
+
+    //d1 h functions (a vector v and t) and d1 f seeds
+    bytes += (uint64_t) this->params.d1 * ((Strategy::key_dim(this->params.dim) + 1) * sizeof(float) + sizeof(uint64_t));
+    return bytes;
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::print_stats(std::ostream & out) const{
+    const int num_of_vertices = 1 << this->params.d1;
+    std::vector<int> sizes(num_of_vertices);
+
+    for (int i = 0 ; i < num_of_vertices ; i++){
+        sizes[i] = this->vertex_ends[i] - this->vertex_offsets[i];
+    }
+    for (auto const& item : this->overflow){
+        sizes[item.first] += item.second.size();
+    }
+
+    print_bucket_stats(out, "Hypercube vertices : ", get_bucket_stats(sizes));
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::set_budget(int M, int probes){
+    this->params.M = M;
+    this->params.probes = probes;
+}
+
+template <typename Strategy>
+bool hypercube<Strategy>::is_removed(const Abstract_Object& abstract_object) const{
+    int id = abstract_object.get_id();
+    return id >= 0 && id < (int) this->tombstones.size() && this->tombstones[id];
+}
+
+template <typename Strategy>
+void hypercube<Strategy>::compaction_step(int max_vertices){
+    for (int i = 0 ; i < max_vertices && i < (1 << this->params.d1) && this->dead_entries > 0 ; i++){
+        const int vertex = this->compact_cursor;
+
+        //erase the entries of removed objects from current vertex, keeping the order of the rest
+        uint32_t end = this->vertex_offsets[vertex];
+        for (uint32_t j = this->vertex_offsets[vertex] ; j < this->vertex_ends[vertex] ; j++){
+            if (this->is_removed(*this->vertex_entries[j]))
+                this->dead_entries--;
+            else
+                this->vertex_entries[end++] = this->vertex_entries[j];
+        }
+
+        auto overflow_it = this->overflow.find(vertex);
+        if (overflow_it != this->overflow.end()){
+            std::vector<const Abstract_Object*>& overflow_list = overflow_it->second;
+            uint32_t overflow_end = 0;
+            for (auto obj_p : overflow_list){
+                if (this->is_removed(*obj_p))
+                    this->dead_entries--;
+                else if (end < this->vertex_offsets[vertex + 1])
+                    this->vertex_entries[end++] = obj_p;    //move overflow entries to the slots freed
+                else
+                    overflow_list[overflow_end++] = obj_p;
+            }
+            overflow_list.resize(overflow_end);
+            if (overflow_list.empty())
+                this->overflow.erase(overflow_it);
+        }
+        this->vertex_ends[vertex] = end;
+
+        this->compact_cursor = (this->compact_cursor + 1) % (1 << this->params.d1);
     }
 }
 //void print() const;
 
-bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &)){
+template <typename Strategy>
+bool hypercube<Strategy>::execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R){
 
 	std::ofstream file (output_file, std::ios::out);		// open output file for output operations
 	
@@ -52,17 +425,19 @@ bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset,
 	double tTrueAvg = 0;
 	double max_AF = 0;
 	int not_found = 0;
+	int truncated_queries = 0;
 
 	for (int i = 0; i < num_of_Objects; i++)		// run for each of the query Objects
 	{
 		file << "Query: query Object " << (query_dataset.get_ith_object(i)).get_name() << "\n";
-		file << "Algorithm: Hypercube  \n\n";
+		file << "Algorithm: Hypercube" << (Strategy::snaps_to_grid ? std::string("_") + Strategy::name() : std::string("")) << "  \n\n";
 
 		//start timer for lsh
 		auto t_cube_start = std::chrono::high_resolution_clock::now();
 		
-		// run approximate nearest neighbors and return the neighbors and the distances found
-		std::vector <std::pair <double, const Abstract_Object*> > appr_nearest = this->appr_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, metric);
+		// run approximate nearest neighbors and return the neighbors and the distances found (stopped at the query budget)
+		bool truncated = false;
+		std::vector <std::pair <double, const Abstract_Object*> > appr_nearest = this->appr_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, &truncated);
 		// end timer for lsh
 		auto t_cube_end = std::chrono::high_resolution_clock::now();
 
@@ -70,7 +445,7 @@ bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset,
 		auto t_true_start = std::chrono::high_resolution_clock::now();
 
 		// run exact nearest neighbors and return the neighbors and the distances found
-		std::vector <std::pair <double, const Abstract_Object*> > exact_nearest = this->exact_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, metric);
+		std::vector <std::pair <double, const Abstract_Object*> > exact_nearest = this->exact_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N);
 		
 		// end timer for brute force
 		auto t_true_end = std::chrono::high_resolution_clock::now();
@@ -117,6 +492,13 @@ bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset,
 			}
 		}
 
+		// queries stopped by their budget are marked, their neighbors are the best found until then
+		if (truncated)
+		{
+			file << "Truncated : query budget reached\n\n";
+			truncated_queries++;
+		}
+
 		// get execution for LSH in milliseconds 
 	    std::chrono::duration <double, std::milli> tCube = t_cube_end - t_cube_start;
 	    // get execution for brute force in milliseconds
@@ -136,7 +518,7 @@ bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset,
 			file << "R-near neighbors: (R = " << R << ")" << '\n';
 
 			// run approximate range search and write results into file
-			std::list <std::pair <double, const Abstract_Object*> > R_list = this->range_search(query_dataset.get_ith_object(i), R, metric);
+			std::list <std::pair <double, const Abstract_Object*> > R_list = this->range_search(query_dataset.get_ith_object(i), R);
 			
 			for (auto item: R_list){
 				// object is within range, so ass it to the list
@@ -158,174 +540,247 @@ bool hypercube::execute(const Dataset & dataset, const Dataset & query_dataset,
 	std::cout << "Max AF = " << max_AF << std::endl;
 	std::cout << "Average AF = " << avg_AF / (N * num_of_Objects - not_found) << std::endl;
 	std::cout << "Average Time Fraction (Cube/True) = " << avg_TF/num_of_Objects << std::endl;
+	std::cout << "Truncated queries = " << truncated_queries << std::endl;
 	std::cout << "Not found = " << not_found << std::endl << std::endl;
 	
 	return true;
 }
 
 
-//The function recursively iterates through all vertices with increasing hamming distance until all are checked or M_rem or probes_rem becomes 0
+//The vertices are visited in the order of probe_masks, until all are checked or M_rem or probes_rem becomes 0
+template <typename Strategy>
+template <typename Sink>
+void hypercube<Strategy>::probe(int query_vertex, const std::vector<uint32_t> & masks, const Abstract_Object & query_object, Sink & sink, query_budget & budget) const{
+    int M_rem = this->params.M;
+    int probes_rem = this->params.probes;
 
-void hypercube::vertex_visiting_first_stage(search_type Type, const int R, int curr_vertex, int ham_dist, int M_rem, int probes_rem, uint curr_bit,
-	void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int N, const int R2){
+    for (uint32_t mask : masks){
+        if (!budget.probe()) return;    //budget spent, keep the objects found so far
+        const uint32_t vertex = query_vertex ^ mask;
 
-	this->vertex_visiting_second_stage(Type, R, curr_vertex, M_rem, probes_rem, curr_bit, ham_dist, max_heap, query_object, metric, N, R2);
+        //the objects of the vertex are its contiguous entries and then its overflow (the later inserts)
+        const std::vector<const Abstract_Object*>* overflow_list = nullptr;
+        if (!this->overflow.empty()){
+            auto overflow_it = this->overflow.find(vertex);
+            if (overflow_it != this->overflow.end())
+                overflow_list = &overflow_it->second;
+        }
 
-	//If all the allowed nodes or verices have been checked or
-	//if we checked the vertex with all the bits having changed, which implies all the vertices have been visited, then end the recursion
-	if (M_rem == 0 || probes_rem == 0 || ham_dist == d1) return;
+        const uint32_t num_of_entries = this->vertex_ends[vertex] - this->vertex_offsets[vertex];
+        const uint32_t size = num_of_entries + (overflow_list != nullptr ? overflow_list->size() : 0);
+        for (uint32_t j = 0 ; j < size ; j++){
+            const Abstract_Object* obj_p = (j < num_of_entries) ? this->vertex_entries[this->vertex_offsets[vertex] + j] : (*overflow_list)[j - num_of_entries];
 
-	this->vertex_visiting_first_stage(Type, R, curr_vertex, ham_dist +1, M_rem, probes_rem, curr_bit, max_heap, query_object, metric, N, R2);
+            //Entries of removed objects not compacted yet are skipped, and do not count against M
+            if (this->is_removed(*obj_p)) continue;
 
+            if (!budget.distance()) return;
+            sink(Strategy::bounded_distance(query_object, *obj_p, sink.bound()), obj_p);
+
+            M_rem -= 1;
+            if (M_rem == 0) break;
+        }
+        probes_rem -= 1;
 
+        //If all the allowed objects or vertices have been checked then stop
+        if (M_rem == 0 || probes_rem == 0) return;
+    }
 }
-void hypercube::vertex_visiting_second_stage(search_type Type, const int R, int curr_vertex, int& M_rem, int& probes_rem, uint curr_bit, int ham_rem,
-	void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int& N, const int R2 ){
 
+template <typename Strategy>
+template <typename Sink>
+void hypercube<Strategy>::search(const Abstract_Object & query_object, Sink & sink, query_budget & budget) const{
+    if (this->params.query_directed){
+        int query_vertex = 0;
+        std::vector<uint32_t> masks = this->query_directed_masks(query_object, query_vertex);
+        this->probe(query_vertex, masks, query_object, sink, budget);
+    }
+    else
+        this->probe(this->get_vertex(query_object), *this->probe_masks, query_object, sink, budget);
+}
 
-	if (ham_rem == 0){
-		this->vertex_visiting_third_stage(Type, R, curr_vertex, M_rem, max_heap, query_object, metric, N, R2);
-		probes_rem -= 1;
-		return;
-	}
+//A set of bits to flip, given by positions in the array of bits sorted by score, and the sum of the squared scores of these bits
+struct perturbation {
+    double score;
+    std::vector<int> positions;     //increasing positions, the last one is the largest
+
+    bool operator>(const perturbation & other) const { return this->score > other.score; }
+};
+
+template <typename Strategy>
+template <typename F>
+int hypercube<Strategy>::score_bits(const Object& key, const std::vector<F>& f, std::vector<std::pair<double, uint32_t> >& bits) const{
+    const int d1 = this->params.d1;
+
+    int vertex = 0;
+    for (int j = 0 ; j < d1 ; j++){
+        float projection = this->h_array[j].project(key);
+        int h = floor(projection);
+        double fraction = projection - h;
+        uint8_t bit = f[j](h);
+
+        //a nearby object may fall in bucket h-1 or h+1 of h_j, and only then its bit differs if f_j maps that bucket to the other bit
+        double score = 1.0 + std::min(fraction, 1.0 - fraction);   //bit changes only past a further bucket
+        if (f[j](h - 1) != bit)
+            score = fraction;
+        if (f[j](h + 1) != bit && 1.0 - fraction < score)
+            score = 1.0 - fraction;
+
+        bits[j] = std::make_pair(score, 1u << (d1 - 1 - j));
+        vertex = (vertex << 1) + bit;
+    }
+    return vertex;
+}
 
-	//If there at at least ham_rem  bits left besides the curr_bit, it is possible to not change the curr_bit of the curr_vertex and change others
-	if ((curr_bit >> ham_rem) != 0){
-		this->vertex_visiting_second_stage(Type, R, curr_vertex, M_rem, probes_rem, curr_bit >> 1, ham_rem, max_heap, query_object, metric, N, R2);
-		if (M_rem == 0 || probes_rem == 0) return;
-	}
+template <typename Strategy>
+std::vector<uint32_t> hypercube<Strategy>::query_directed_masks(const Abstract_Object & query_object, int & query_vertex) const{
+    const int d1 = this->params.d1;
+    const Object* key = this->hash_key(query_object);
 
-	this->vertex_visiting_second_stage(Type, R, curr_vertex xor curr_bit, M_rem, probes_rem, curr_bit >> 1, ham_rem -1, max_heap, query_object, metric, N, R2);
-}
+    //score of each bit and the mask which flips it (bit j of the vertex is at position d1-1-j, see get_vertex)
+    std::vector<std::pair<double, uint32_t> > bits(d1);
 
-void hypercube::vertex_visiting_third_stage(search_type Type, const int R, int curr_vertex, int& M_rem, void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int& N, const int R2){
+    query_vertex = this->legacy_f_array.empty() ? this->score_bits(*key, this->f_array, bits) : this->score_bits(*key, this->legacy_f_array, bits);
+    this->release_hash_key(key);
 
-	std::list<const Abstract_Object*>& vertex_list = this->cube_array[curr_vertex];
-	for(auto obj_p : vertex_list){
-		double dist = (*metric)(query_object, *obj_p);
+    std::sort(bits.begin(), bits.end());
 
-		// If the search type is kNN we don't care about the distance, just put it in the heap.
-		// Otherwise, the search type is range search thus we want the distance to be smaller than R
-		if (Type == kNN){
-			
-			push_at_most_N(obj_p, N, dist, (std::priority_queue <std::pair <double, const Abstract_Object*> >* ) max_heap);
-		}
-		// If the point belongs to the ring [R2, R) then add it to the list
-		else if (R2 <= dist && dist < R){
+    //as many masks as the vertices that may be probed
+    size_t max_masks = this->probe_masks->size();
+    if (this->params.probes > 0 && (size_t) this->params.probes < max_masks)
+        max_masks = this->params.probes;
 
-				std::list <std::pair <double, const Abstract_Object*> >* casted_p = (std::list <std::pair <double, const Abstract_Object*> >* ) max_heap;
-				casted_p->push_back(std::make_pair(dist, obj_p));
-		}
-		M_rem -= 1;
-		if (M_rem == 0) return;
-	}
-}
+    std::vector<uint32_t> masks;
+    masks.reserve(max_masks);
+    masks.push_back(0);     //the vertex of the query itself is probed first
 
-void push_at_most_N(const Abstract_Object* obj_p, int N, double dist, std::priority_queue <std::pair <double, const Abstract_Object*> >* max_heap){
-	if ((int) max_heap->size() < N)	// if we haven't found N neighbors yet
-		max_heap->push(std::make_pair(dist, obj_p));	// simply push the new object-neighbor found
-	else{
-		// N neighbors have already been found, so compare with largest distance
-		double largest_dist = std::get<0>(max_heap->top());
-		if (dist < largest_dist){	// if new object is closer
-			max_heap->pop();									// pop the Object with the largest distance
-			max_heap->push(std::make_pair(dist, obj_p));	// and insert the new object
-		}
-	}
-}
+    //sets of bits are generated in increasing score by shifting (moving the last position one up)
+    // and expanding (adding the position after the last one) the set with the smallest score, so that every set is generated once
+    std::priority_queue<perturbation, std::vector<perturbation>, std::greater<perturbation> > heap;
+    if (d1 > 0)
+        heap.push(perturbation{bits[0].first * bits[0].first, std::vector<int>(1, 0)});
 
-std::vector <std::pair <double, const Abstract_Object*> > hypercube::appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &))
-{
+    while (masks.size() < max_masks && !heap.empty()){
+        perturbation smallest = heap.top();
+        heap.pop();
 
-	// run approximate kNN
+        uint32_t mask = 0;
+        for (int position : smallest.positions)
+            mask |= bits[position].second;
+        masks.push_back(mask);
 
-	// initialize a min heap priority queue, that will store the Object identifier string name and the distance of Object from query object
-	std::priority_queue <std::pair <double, const Abstract_Object*> > max_heap;
+        int last = smallest.positions.back();
+        if (last + 1 < d1){
+            double next_score = bits[last + 1].first * bits[last + 1].first;
 
-	int query_vertex = 0;
+            perturbation shifted = smallest;
+            shifted.positions.back() = last + 1;
+            shifted.score += next_score - bits[last].first * bits[last].first;
+            heap.push(shifted);
 
-	for (int j = 0 ; j < d1 ; j++){
-            query_vertex = (query_vertex << 1) + this->get_0_or_1(j, query_object);
+            perturbation expanded = smallest;
+            expanded.positions.push_back(last + 1);
+            expanded.score += next_score;
+            heap.push(expanded);
+        }
     }
 
-	this->vertex_visiting_first_stage(kNN, 0, query_vertex, 0, M, probes, 1 << (d1-1), (void*) & max_heap, query_object, metric, N);
+    return masks;
+}
 
-	// initialize a vector with how many exact nearest neighbors were found
-	std::vector <std::pair <double, const Abstract_Object*> > nearest(max_heap.size());
+template <typename Strategy>
+std::vector <std::pair <double, const Abstract_Object*> > hypercube<Strategy>::appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, bool * truncated)
+{
 
-	for (int i = nearest.size() - 1; i >= 0; --i)	// for each nearest neighbor found
-	{
-		nearest[i] = max_heap.top();	// save nearest neighbor
-		max_heap.pop();
-	}
+	// run approximate kNN, within the query budget
 
-	return nearest;
+	// the sink keeps the N nearest objects found, in a max heap
+	knn_sink sink(N);
+	query_budget budget(this->params);
+	this->search(query_object, sink, budget);
+
+	if (truncated != nullptr)
+		*truncated = budget.is_truncated();
+
+	return sink.nearest.sorted();
 }
 
 
-std::list <std::pair <double, const Abstract_Object*> > hypercube::range_search(const Abstract_Object & query_object, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &),  const int R2)
+template <typename Strategy>
+std::list <std::pair <double, const Abstract_Object*> > hypercube<Strategy>::range_search(const Abstract_Object & query_object, const int & R,  const int R2)
 {
 
-	int query_index = 0;
+	// the sink keeps the objects found in the ring [R2, R)
+	range_sink sink(R, R2);
+	query_budget budget;    //range searches are not bounded by the query budget
+	this->search(query_object, sink, budget);
 
-	for (int j = 0 ; j < d1 ; j++){
-            query_index = (query_index << 1) + this->get_0_or_1(j, query_object);
-    }
-
-	std::list <std::pair <double, const Abstract_Object*> > R_list;
+	return sink.R_list;
+}
 
-	this->vertex_visiting_first_stage(RANGE_SEARCH, R, query_index, 0, M, probes, 1 << (d1-1), (void*) & R_list, query_object, metric,0, R2);
+template <typename Strategy>
+std::vector <std::pair <double, const Abstract_Object*> > hypercube<Strategy>::probed_objects(const Abstract_Object & query_object) const
+{
+	probed_sink sink;
+	query_budget budget;    //range searches are not bounded by the query budget
+	this->search(query_object, sink, budget);
 
-	return R_list;
+	return sink.objects;
 }
 
-std::vector <std::pair <double, const Abstract_Object*> > hypercube::exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &)){
+template <typename Strategy>
+std::vector <std::pair <double, const Abstract_Object*> > hypercube<Strategy>::exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N){
 	// run brute force exact kNN
 	int num_of_Objects = dataset.get_num_of_Objects();
+	Curve* fred_curve = nullptr;
+	if (Strategy::uses_fred){
+		fred_curve = transform_to_Fred_Curve(static_cast<const Object&> (query_object));
+	}
 
-	// initialize a max heap priority queue, that will store the distance of Object from query object and a pointer to the Object itself
-	std::priority_queue <std::pair <double, const Abstract_Object*> > max_heap;
+	// dataset objects are split into contiguous chunks, each thread keeps the N nearest objects of its chunk
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? BRUTE_FORCE_CURVE_CHUNK : BRUTE_FORCE_CHUNK);
+	std::vector <top_k> partial(threads, top_k(N));
 
-	// check each of the dataset objects by brute force
-	for (int i = 0; i < num_of_Objects; ++i)
+	parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
 	{
-		// find its distance from query object
-		double dist = (*metric)(query_object, dataset.get_ith_object(i));
-
-		if ((int) max_heap.size() < N)	// if we haven't found N neighbors yet
-			max_heap.push(std::make_pair(dist, & dataset.get_ith_object(i)));
-		else
+		// check each of the dataset objects of the chunk by brute force
+		for (int i = begin; i < end; ++i)
 		{
-			// N neighbors have already been found, so compare with largest distance
-			double largest_dist = std::get<0>(max_heap.top());
+			if (dataset.is_removed(i))		// skip removed objects
+				continue;
 
-			if (dist < largest_dist)	// if new object is closer
-			{
-				max_heap.pop();									// pop the Object with the largest distance
-				max_heap.push(std::make_pair(dist, & dataset.get_ith_object(i)));	// and insert the new object
-			}
-		}
-	}
+			// find its distance from query object (continuous frechet distance of the fred library, if the strategy uses it)
+			double dist = 0;
+			if (Strategy::uses_fred && fred_curve->complexity() >= 2 && this->curve_vect[i]->complexity() >= 2)
+				dist = (Frechet::Continuous::distance(*(this->curve_vect[i]), *fred_curve)).value;
+			else
+				dist = Strategy::bounded_distance(query_object, dataset.get_ith_object(i), partial[thread].bound());	//abandoned past the N-th nearest of the chunk so far
 
-	// initialize a vector with how many exact nearest neighbors were found
-	std::vector <std::pair <double, const Abstract_Object*> > nearest(max_heap.size());
-	for (int i = nearest.size() - 1; i >= 0; --i)	// for each nearest neighbor found
-	{
-		nearest[i] = max_heap.top();	// save nearest neighbor
-		max_heap.pop();
+			partial[thread].push(dist, & dataset.get_ith_object(i));
+		}
+	});
+
+	// the N nearest of the partial results are the N nearest objects of the dataset
+	top_k nearest(N);
+	for (auto const& thread_nearest : partial)
+		nearest.merge(thread_nearest);
+	if (Strategy::uses_fred){
+		delete fred_curve;
 	}
 
-	return nearest;
+	return nearest.sorted();
 }
 
 
 
-hypercube::~hypercube(){
-    delete[] this->cube_array;
-    delete[] this->f_array;
-    delete[] this->h_array;
-
+template <typename Strategy>
+hypercube<Strategy>::~hypercube(){
+    for (size_t i = 0 ; i < this->curve_vect.size() ; i++){
+        delete this->curve_vect[i];
+    }
 }
+
+// the hypercube is compiled for each strategy it is used with
+template class hypercube<vector_strategy>;
+template class hypercube<discrete_frechet_strategy>;
+template class hypercube<continuous_frechet_strategy>;
@@ -10,65 +10,130 @@
 #include "object.hpp"
 #include "dataset.hpp"
 #include "search_method.hpp"
+#include "index_io.hpp"
+#include "index_params.hpp"
+#include "strategies.hpp"
+#include "rng.hpp"
+#include "h_grid.hpp"
+#include "query_budget.hpp"
+#include "fred/include/curve.hpp"
 #include <queue>
 #include <list>
+#include <vector>
 #include <set>
+#include <unordered_map>
 
-//An enum type used in the recursion part of the hypercube so that the appropriate action is taken
-enum search_type {kNN, RANGE_SEARCH};
-
+// class hypercube projects the objects on the vertices of a d1-dimensional hypercube
+// Strategy (see strategies.hpp) defines how objects are hashed and the metric used to compare them
+// (curves are snapped to the grid of the cube first, and their grid curves are projected as vectors, as in the lsh hash tables)
+template <typename Strategy>
 class hypercube : public search_method {
 private:
-    std::list<const Abstract_Object*>* cube_array; //every vertex of the hypercube will store Abstract_Object pointers in a similar fashion to the lsh hashtables
-                                    //The array will have size 2^d1 where d1 is the dimension of the cube
-    f_hash* f_array;                //create d1 functions which assign integers randomly to {0,1} 
-    h_hash* h_array;                //create d1 h_hash functions
+    index_params params;            //parameters the cube was built with
+    //The objects of all the 2^d1 vertices (d1 is the dimension of the cube) are stored in a single array, sorted by vertex (counting sort),
+    // so that probing a vertex scans contiguous memory : vertex i holds vertex_entries[vertex_offsets[i], vertex_ends[i])
+    //The slots [vertex_ends[i], vertex_offsets[i+1]) were freed by the compaction and are reused by the next inserts to vertex i
+    std::vector<const Abstract_Object*> vertex_entries;
+    std::vector<uint32_t> vertex_offsets;   //size 2^d1 + 1
+    std::vector<uint32_t> vertex_ends;      //size 2^d1
+    std::unordered_map<uint32_t, std::vector<const Abstract_Object*> > overflow;  //objects inserted to a vertex when it has no free slots left
+                                                                                  //(only vertices with such objects have an entry)
+    std::vector<f_hash> f_array;    //create d1 functions which assign integers randomly to {0,1} 
+    std::vector<legacy_f_hash> legacy_f_array;  //the d1 f functions of a cube loaded from a version 1 snapshot, used instead of f_array
+                                                //(empty otherwise, the choice is made once per vertex, not per bit)
+    std::vector<h_hash> h_array;    //create d1 h_hash functions
+    h_grid h_delta;                 //grid the curves are snapped to before they are projected (not used for vectors)
+    std::vector<Curve*> curve_vect; //copies of the input curves as curves of the fred library, for the exact continuous frechet distances
+                                    //(empty unless the strategy uses fred, indexed by object id)
+    std::vector<bool> tombstones;   //tombstones[id] is true if the object with that id was removed from the cube
+    int dead_entries;               //number of entries of removed objects still left in the vertices
+    int compact_cursor;             //vertex where the next incremental compaction starts
+    const std::vector<uint32_t>* probe_masks;   //all the 2^d1 vertex masks in increasing hamming distance (and increasing value for the same distance),
+                                                //the vertices probed for a query are query_vertex xor probe_masks[0], probe_masks[1], ...
+                                                //(one immutable table per d1, shared by every cube of that dimension)
 
-    //Find the value (0 or 1) of the i-th coordinate of the vertex of the d1-hypercube for the given object
-    uint8_t get_0_or_1(int i, const Abstract_Object& abstract_object);
-    
+    //Returns the vector the h functions are applied to for given object : the object itself for vectors,
+    // or its grid curve flattened to a vector for curves (a new object, released with release_hash_key)
+    const Object* hash_key(const Abstract_Object& abstract_object) const;
+    void release_hash_key(const Object* key) const;
+    //Returns the vertex of the hypercube the given object is mapped to
+    int get_vertex(const Abstract_Object& abstract_object) const;
+    //Stores given objects in the vertices given (objects[i] in vertex vertices[i]) with a counting sort, replacing the previous vertices contents
+    void build_vertices(const std::vector<const Abstract_Object*> & objects, const std::vector<uint32_t> & vertices);
+    //Returns true if given object was removed from the cube (its entry may not be compacted away yet)
+    bool is_removed(const Abstract_Object& abstract_object) const;
+    //Compacts at most max_vertices vertices, starting where the previous call stopped
+    void compaction_step(int max_vertices);
 
-    //Functions used for the recursion in which the vertices are visited in increasing hamming distance
-    // Also the remaining allowed number of vertices and points-Objects which can be visited are defined by probes_rem and M_rem
-    //Since the reucrsion is used for both kNN and Range search, all necessary parameters needed for both are included
-    // Finally, depending on whether search_type Type is kNN or Range_search, max_heap will actually be a max heap defined as a priority queue or it will be a set
-    // thus we use void* so that the appropriate cast is used
-    // (Initially a template was used for references to the priority queue or set instead of void* but there waw an error of unknown origin and the template was discarded)
-    void vertex_visiting_first_stage(search_type Type, const int R, int curr_vertex, int ham_dist, int M_rem, int probes_rem, uint curr_bit, void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int N, const int R2 = 0);
-    
-    void vertex_visiting_second_stage(search_type Type, const int R, int curr_vertex, int& M_rem, int& probes_rem, uint curr_bit, int ham_rem, void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int& N, const int R2 = 0);
+    //Returns the vertex of the d1-hypercube of the given hash key, with the given f functions (f_array or legacy_f_array)
+    template <typename F>
+    int key_vertex(const Object& key, const std::vector<F>& f) const;
+    //Sets the score of each bit of the vertex of the given hash key and its mask (see query_directed_masks), and returns the vertex
+    template <typename F>
+    int score_bits(const Object& key, const std::vector<F>& f, std::vector<std::pair<double, uint32_t> >& bits) const;
     
-    void vertex_visiting_third_stage(search_type Type, const int R, int curr_vertex, int& M_rem, void* max_heap,
-								const Abstract_Object & query_object, double (*metric)(const Abstract_Object &, const Abstract_Object &), int& N, const int R2 = 0);
+
+    //Returns the masks of the vertices to probe for the given query in query-directed order, and its vertex in query_vertex
+    // each bit of the query vertex gets a score, the distance of the query's projection from the closest boundary of its h bucket
+    // past which f gives the other bit (uncertain bits have small scores), and sets of bits to flip are ranked by their sum of squared scores
+    std::vector<uint32_t> query_directed_masks(const Abstract_Object & query_object, int & query_vertex) const;
+
+    //Visits the vertices query_vertex xor masks[0], masks[1], ... until M objects or probes vertices have been checked (or the budget is spent),
+    // and passes every object found with its distance from the query object to sink
+    // Sink is a kNN or range search sink (see hypercube_class.cpp), i.e. a functor taking the distance and the object found,
+    // whose bound() is the distance past which it drops objects (so each distance is abandoned there)
+    template <typename Sink>
+    void probe(int query_vertex, const std::vector<uint32_t> & masks, const Abstract_Object & query_object, Sink & sink, query_budget & budget) const;
+
+    //Finds the vertex of the query and the masks of the vertices to probe for it (in the order set by the parameters), and probes them
+    template <typename Sink>
+    void search(const Abstract_Object & query_object, Sink & sink, query_budget & budget) const;
 
 public:
 
-    hypercube();
+    //Constructor, the hash functions are drawn from given generator
+    hypercube(const index_params & params, rng & generator);
+    // constructor through an index snapshot (after its header), reads the hash functions and the vertices contents of a cube built on given dataset
+    // (given generator is only used for the f functions of a version 1 snapshot, for the values they had not evaluated)
+    hypercube(index_reader & reader, const Dataset & dataset, const index_params & params, rng & generator);
 
     //For each object, index is which vertex of the hypercube the object will be stored, encoded in the rightmost d1 digits
     // e.g if index = 0b00001011 and d1 = 5 that means the object will be inserted at the vertex (1,1,0,1,0) where 
     // the 5 rightmost bits where taken in reverse order
     void import_data(const Dataset& obj);
 
-    // executes the approximate/exact/ranged nearest neighbors algorithms using given metric function (pointer to function)
+    // writes the hash functions and the vertices contents to an index snapshot file
+    bool save_index(const std::string & index_file, const Dataset & dataset) const;
+
+    //Inserts a single object into the vertex it is mapped to
+    void insert(const Abstract_Object & object);
+    //Removes a single object from the cube (tombstone, compacted away incrementally by the updates that follow)
+    void remove(const Abstract_Object & object);
+    //Compacts away at once all entries of removed objects
+    void compact();
+    //Returns the approximate number of bytes taken by the vertices, the probe masks and the hash functions
+    uint64_t memory_usage() const;
+    //Prints the occupancy statistics of the vertices (overflow objects included)
+    void print_stats(std::ostream & out) const;
+    //Sets the max number of objects (M) and vertices (probes) checked per query, the cube does not need to be built again
+    void set_budget(int M, int probes);
+
+    // executes the approximate/exact/ranged nearest neighbors algorithms
 	// and outputs results and execution times in output file
-	bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &));
-	// runs approximate and exact nearest neighbors using given metric function and write results into file
-	std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &));
-	// run approximate range search using given metric function and save results in a set (with their distances from the query object)
+	bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R);
+	// runs approximate nearest neighbors and returns the neighbors found with their distances
+	std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, bool * truncated = nullptr);
+	// run approximate range search and save results in a set (with their distances from the query object)
     // Ignore objects whose ids are in the visited set
     // By default, the visited set will be empty which means all the objects found will be returned
-	std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &), const int R2 = 0);
+	std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, const int R2 = 0);
+    // returns every object a range search of the given query object checks (whatever the radius), with its distance from the query object
+    std::vector <std::pair <double, const Abstract_Object*> > probed_objects(const Abstract_Object & query_object) const;
 
-    std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+    std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N);
 
     //void print() const;
     ~hypercube();
 };
 
-//Make sure the priority queue only stores at most N from the currently found objects since more than N are not needed
-void push_at_most_N(const Abstract_Object* obj_p, int N, double dist, std::priority_queue <std::pair <double, const Abstract_Object*> >* max_heap);
-
 #endif
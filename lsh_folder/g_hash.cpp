@@ -7,63 +7,92 @@
 #include <cmath>
 #include <cstdint>
 
-g_hash::g_hash()
+g_hash::g_hash(rng & generator, int k, int dim, int w) : r(k)
 {
-	// creates and calls default constructor for each of the k h-hash functions
-	h  = new h_hash[k];		
-	// creates an array of k integers
-	r = new int[k];
+	// h is created as an array of k random h-hash functions
+	h.reserve(k);
+	for (int i = 0; i < k; ++i)
+		h.emplace_back(generator, dim, w);
+
+	// r is created as an array of k integers
 	// picks k random positive integers and stores them into array r
 	const int lower_bound = 1;
 	const int upper_bound = 10000;
-
-	std::random_device rd;
-	std::mt19937 generator(rd());
-	std::uniform_int_distribution<int> distr(lower_bound, upper_bound);
 	
 	for (int i = 0; i < k; ++i)
 	{
-		r[i] = distr(generator);
+		r[i] = generator.uniform_int(lower_bound, upper_bound);
 	}
 
 }
 
-int g_hash::operator()(const Abstract_Object& abstract_object, int table_size, uint32_t & object_id) const
+g_hash::g_hash(index_reader & reader, int k, int w)
 {
-	uint32_t M = 0xfffffffb;		// large prime M = 2^32 - 5, <= 32 bits
+	h.reserve(k);
+	for (int i = 0; i < k; ++i)
+		h.emplace_back(reader, w);		// read each of the k h-hash functions
+
+	uint64_t count = 0;
+	const int32_t * coefficients = reader.read_array<int32_t>(count);
+
+	if (count != (uint64_t) k)		// snapshot should have exactly k coefficients
+	{
+		reader.fail();
+		count = 0;
+	}
+
+	r.assign(coefficients, coefficients + count);
+}
+
+void g_hash::save(index_writer & writer) const
+{
+	for (int i = 0; i < (int) this->h.size(); ++i)
+		this->h[i].save(writer);
+
+	std::vector <int32_t> coefficients(this->r.begin(), this->r.end());
+	writer.write_array(coefficients.data(), coefficients.size());
+}
 
+int g_hash::operator()(const Abstract_Object& abstract_object, int table_size, uint32_t & object_id) const
+{
 	// convert abstract object to Object
 	const Object * p = abstract_object.to_Object();
 
+	int index = (*this)(*p, table_size, object_id);
+
+	// delete temporary Object
+	delete p;
+
+	return index;
+}
+
+int g_hash::operator()(const Object& p, int table_size, uint32_t & object_id) const
+{
+	uint32_t M = 0xfffffffb;		// large prime M = 2^32 - 5, <= 32 bits
+	const int k = this->h.size();	// number of h hash functions composing g
+
 	// following block of code does a linear combination of h_i with r_i avoiding overflow
 	// by casting to int64_t before each + or * operation
 	// and using the modulo property that (a op b) mod M = [(a mod M) op (b mod M)] mod M, where op = + or *
 	
-	// calculate right nested operand : (r[k-1] * h[k-1](*p)) mod M = ( r[k-1] mod M ) * ( h[k-1](*p) mod M ) mod M
-	int64_t right = mod(mod((int64_t) this->r[k-1], (int64_t) M) * mod((int64_t) (this->h[k-1])(*p), (int64_t) M), (int64_t) M);
+	// calculate right nested operand : (r[k-1] * h[k-1](p)) mod M = ( r[k-1] mod M ) * ( h[k-1](p) mod M ) mod M
+	int64_t right = mod(mod((int64_t) this->r[k-1], (int64_t) M) * mod((int64_t) (this->h[k-1])(p), (int64_t) M), (int64_t) M);
 	int64_t left;
 
 	for (int i = k-2; i >= 0; --i)
 	{
-		// calculate left nested operand : [ r[i] * h[i](*p) ] mod M = ( r[i] mod M ) * ( h[i](*p) mod M ) mod M
-		left = mod(mod((int64_t) this->r[i], (int64_t) M) * mod((int64_t) (this->h[i])(*p), (int64_t) M), (int64_t) M);
+		// calculate left nested operand : [ r[i] * h[i](p) ] mod M = ( r[i] mod M ) * ( h[i](p) mod M ) mod M
+		left = mod(mod((int64_t) this->r[i], (int64_t) M) * mod((int64_t) (this->h[i])(p), (int64_t) M), (int64_t) M);
 		right = mod(left + right, (int64_t) M);		// calculate new right nested operand
 	}
 
 	object_id = (uint32_t) right; // right is always a number mod M, so positive and at most as big as M (32 bits), so this cast is safe
 
-	// delete temporary Object
-	delete p;
-
 	// return calculated table index
 	return object_id % table_size;
 }
 
-g_hash::~g_hash()
-{
-	delete[] r;
-	delete[] h;
-}
+g_hash::~g_hash() {}
 
 int64_t mod(int64_t x, int64_t y)
 {
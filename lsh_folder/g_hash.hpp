@@ -3,24 +3,34 @@
 #define _G_HASH_HPP_
 #include <iostream>
 #include <cstdint>
+#include <vector>
 #include "object.hpp"
 #include "h_hash.hpp"
 #include "params.hpp"
+#include "index_io.hpp"
+#include "rng.hpp"
 
 // class g_hash is used to hold info about an amplified g hash function
 
 class g_hash
 {
 private:
-	h_hash * h;		// an array of h_hash functions since each amplified hash function is composed using k h hash functions
-	int  * r;		// an array to hold k random numbers, coeffecients of the k h hash functions used to compose g
+	std::vector <h_hash> h;		// an array of h_hash functions since each amplified hash function is composed using k h hash functions
+	std::vector <int> r;		// an array to hold k random numbers, coeffecients of the k h hash functions used to compose g
 
 public:
-	// default constructor
-	g_hash();
+	// constructor, randomly chooses the k h hash functions (for vectors of dimension dim) and their coefficients using given generator
+	g_hash(rng & generator, int k, int dim, int w);
+	// constructor through an index snapshot, reads the k h hash functions and their coefficients
+	g_hash(index_reader & reader, int k, int w);
 	~g_hash();
+	// writes the k h hash functions and their coefficients to an index snapshot
+	void save(index_writer & writer) const;
 	// overload of () operator, so that each g_hash object can be used as a "function"
-	int operator()(const Abstract_Object& abstract_object, int table_size, uint32_t & object_id) const;	
+	// any abstract object is first converted to an Object (a copy)
+	int operator()(const Abstract_Object& abstract_object, int table_size, uint32_t & object_id) const;
+	// same as above, for an Object used as it is (no copy, no virtual call)
+	int operator()(const Object& p, int table_size, uint32_t & object_id) const;
 };
 
 
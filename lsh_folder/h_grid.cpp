@@ -8,19 +8,37 @@
 #include <vector>
 
 // create a signle precision reat t uniformly in [0,delta)^dim,
-h_grid::h_grid(int dim){
+h_grid::h_grid(int dim, double delta, int complexity, rng & generator) : delta(delta), complexity(complexity){
 	const float lower_bound = 0.0;
 	const float upper_bound = (float) delta;
-	std::random_device rd;
-	std::mt19937 generator(rd());
-	std::uniform_real_distribution<float> distr(lower_bound, upper_bound);
 	for (int i = 0 ; i  < dim ; i++){
-		t.push_back(distr(generator));
+		t.push_back(generator.uniform(lower_bound, upper_bound));
 	}
 }
 
+h_grid::h_grid(index_reader & reader, double delta, int complexity, int dim) : delta(delta), complexity(complexity)
+{
+	uint64_t num_of_shifts = 0;
+	const double * shifts = reader.read_array<double>(num_of_shifts);
+
+	// snapping reads t[0] (and t[1] for 2-dimensional curves), so a grid of another dimension is invalid
+	if (num_of_shifts != (uint64_t) dim)
+	{
+		reader.fail();
+		t.assign(dim, 0.0);
+		return;
+	}
+
+	t.assign(shifts, shifts + num_of_shifts);
+}
+
+void h_grid::save(index_writer & writer) const
+{
+	writer.write_array(this->t.data(), this->t.size());
+}
+
 Abstract_Object * h_grid::operator()(const Abstract_Object& time_series) const
 {
-	return time_series.to_grid_curve(this->t);
+	return time_series.to_grid_curve(this->t, this->delta, this->complexity);
 }
 	
@@ -4,6 +4,11 @@
 #include <iostream>
 #include <vector>
 #include "object.hpp"
+#include "index_io.hpp"
+#include "rng.hpp"
+
+// dimension of the grid the hash tables and the hypercube snap curves to (curves of 1-dimensional points only use its first coordinate)
+#define H_GRID_DIM 2
 
 // class h_grid is used to hold info about an h grid hash function ( maps time series to G_delta 2-dimensional grid or 1-dimensional grid)
 
@@ -12,10 +17,16 @@ class h_grid
 private:
 	// a single precision real t uniformly in [0,delta)^2
 	std::vector<double> t;	
+	double delta;		// size of the grid cells
+	int complexity;		// original complexity of the curves, grid curves of filtered curves are padded up to it
 
 public:
-	// create a signle precision reat t uniformly in [0,delta)^dim, (Initialised to 2 for the needs of this project)
-	h_grid(int dim = 2);
+	// create a signle precision reat t uniformly in [0,delta)^dim using given generator, (dim is 2 for the needs of this project)
+	h_grid(int dim, double delta, int complexity, rng & generator);
+	// constructor through an index snapshot, reads t (the snapshot fails unless t has dim coordinates, the dim the grid was created with)
+	h_grid(index_reader & reader, double delta, int complexity, int dim);
+	// writes t to an index snapshot
+	void save(index_writer & writer) const;
 	// overload of () operator, so that each h_grid object can be used as a "function"
 	// complexity is the original complexity of the curves before they passed the filter
 	// (necessary for query compatibility with query curves
@@ -7,79 +7,277 @@
 #include <list>
 #include <utility>
 #include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
+#include "strategies.hpp"
 
-hash_table::hash_table(int numBuckets, int dim) : size(0), capacity(numBuckets), h_delta(dim)
+// returns the size of the largest bucket, if the locality IDs counted in id_counts are spread over numBuckets buckets
+static int largest_bucket(const std::unordered_map <uint32_t, int> & id_counts, int numBuckets)
 {
-	// calls default constructor for g hash function of hash table
+	std::vector <int> sizes(numBuckets, 0);
+	int largest = 0;
+
+	for (auto const& id_count : id_counts)
+	{
+		int & size = sizes[id_count.first % numBuckets];
+		size += id_count.second;
+		largest = std::max(largest, size);
+	}
+
+	return largest;
+}
+
+template <typename Strategy>
+hash_table<Strategy>::hash_table(int numBuckets, const index_params & params, rng & generator, int dim) : size(0), capacity(numBuckets), compact_cursor(0),
+	g(generator, params.k, Strategy::key_dim(params.dim), params.w), h_delta(dim, params.delta, params.dim, generator)
+{
+	// g hash function and grid of hash table are chosen randomly
 	// allocates memory for the table of lists
 	table = new std::list <std::pair <const Abstract_Object*, uint32_t> >[numBuckets];
 }
 
-hash_table::~hash_table()
+template <typename Strategy>
+hash_table<Strategy>::hash_table(index_reader & reader, const Dataset & dataset, const index_params & params) : size(0), capacity(reader.read<int32_t>()), compact_cursor(0),
+	g(reader, params.k, params.w), h_delta(reader, params.delta, params.dim, H_GRID_DIM)
+{
+	if (this->capacity <= 0)		// invalid snapshot, keep a single empty bucket
+	{
+		reader.fail();
+		this->capacity = 1;
+	}
+
+	table = new std::list <std::pair <const Abstract_Object*, uint32_t> >[this->capacity];
+
+	// bucket contents are stored as offsets to arrays of object ids and locality IDs (bucket i is [offsets[i], offsets[i+1]) )
+	uint64_t num_of_offsets = 0, num_of_ids = 0, num_of_locality_ids = 0;
+	const uint32_t * offsets = reader.read_array<uint32_t>(num_of_offsets);
+	const int32_t * ids = reader.read_array<int32_t>(num_of_ids);
+	const uint32_t * locality_ids = reader.read_array<uint32_t>(num_of_locality_ids);
+
+	if (!reader.good() || num_of_offsets != (uint64_t) this->capacity + 1 || num_of_ids != num_of_locality_ids || offsets[this->capacity] != num_of_ids)
+	{
+		reader.fail();
+		return;
+	}
+
+	for (int i = 0; i < this->capacity; ++i)
+	{
+		if (offsets[i] > offsets[i+1])		// offsets should be non decreasing
+		{
+			reader.fail();
+			return;
+		}
+
+		for (uint32_t j = offsets[i]; j < offsets[i+1] && j < num_of_ids; ++j)
+		{
+			if (ids[j] < 0 || ids[j] >= dataset.get_num_of_Objects())	// ids should refer to objects of given dataset
+			{
+				reader.fail();
+				return;
+			}
+
+			this->table[i].push_back(std::make_pair(& dataset.get_ith_object(ids[j]), locality_ids[j]));
+			this->size++;
+		}
+	}
+}
+
+template <typename Strategy>
+void hash_table<Strategy>::save(index_writer & writer) const
+{
+	writer.write((int32_t) this->capacity);
+	this->g.save(writer);
+	this->h_delta.save(writer);
+
+	// flatten buckets into offsets, object ids and locality IDs arrays
+	std::vector <uint32_t> offsets(this->capacity + 1, 0);
+	std::vector <int32_t> ids;
+	std::vector <uint32_t> locality_ids;
+
+	for (int i = 0; i < this->capacity; ++i)
+	{
+		for (auto const& object_info : this->table[i])
+		{
+			ids.push_back((std::get<0>(object_info))->get_id());
+			locality_ids.push_back(std::get<1>(object_info));
+		}
+		offsets[i+1] = ids.size();
+	}
+
+	writer.write_array(offsets.data(), offsets.size());
+	writer.write_array(ids.data(), ids.size());
+	writer.write_array(locality_ids.data(), locality_ids.size());
+}
+
+template <typename Strategy>
+hash_table<Strategy>::~hash_table()
 {
 	delete[] table;
 }
 
-int hash_table::get_size() const
+template <typename Strategy>
+int hash_table<Strategy>::get_size() const
 {
 	return this->size;
 }
 
-int hash_table::get_capacity() const
+template <typename Strategy>
+int hash_table<Strategy>::get_capacity() const
 {
 	return this->capacity;
 }
 	
-void hash_table::insert(const Abstract_Object& p, int complexity)
+template <typename Strategy>
+void hash_table<Strategy>::insert(const Abstract_Object& p)
 {
 	uint32_t object_id = 0;
 
-	// different insert hash function depending on algorithm
-	if (algorithm == "LSH")
-	{
-		int index = g(p, this->capacity, object_id);				 // g hash function is used to get index in hash-table and locality object_id of given object
-		this->table[index].push_back(std::make_pair(&p, object_id)); // pointer to given Abstract-Object and its locality ID are inserted at index
-	}
-	else if (algorithm == "Frechet" /*&& metric_func == "discrete"*/)
-	{
-		// we first apply the grid function h_delta
-		const Abstract_Object * gridCurve = h_delta(p);
-		int index = g(*gridCurve, this->capacity, object_id);		  // g hash function is used to get index in hash-table and locality object_id of given object
-		this->table[index].push_back(std::make_pair(&p, object_id));  // pointer to given Abstract-Object and its locality ID are inserted at index
-		delete gridCurve;
-	}
-	#if 0
-	else if (algorithm == "Frechet" /*&& metric_func == "continuous"*/){
-		// we first apply the grid function h_delta
-		const Abstract_Object * gridCurve = h_delta(p);
-		int index = g(*gridCurve, this->capacity, object_id);		  // g hash function is used to get index in hash-table and locality object_id of given object
-		this->table[index].push_back(std::make_pair(&p, object_id));  // pointer to given Abstract-Object and its locality ID are inserted at index
-		delete gridCurve;
-	}
-	#endif
+	// g hash function is used to get index in hash-table and locality object_id of given object
+	int index = this->get_bucket_index(p, object_id);
+	this->table[index].push_back(std::make_pair(&p, object_id)); // pointer to given Abstract-Object and its locality ID are inserted at index
+	this->size++;
 }
 
-int hash_table::get_bucket_index(const Abstract_Object& p, uint32_t & object_id)
+template <typename Strategy>
+int hash_table<Strategy>::compact(const std::vector <bool> & tombstones, int max_buckets)
 {
-	int index = 0;
+	int removed = 0;
 
-	// different hash function depending on algorithm
-	if (algorithm == "LSH")
+	for (int i = 0; i < max_buckets && i < this->capacity; ++i)
 	{
-		index = g(p, this->capacity, object_id);
+		std::list <std::pair <const Abstract_Object*, uint32_t> > & bucket = this->table[this->compact_cursor];
+
+		// erase the entries of removed objects from current bucket
+		for (auto it = bucket.begin(); it != bucket.end(); )
+		{
+			int id = (std::get<0>(*it))->get_id();
+
+			if (id < (int) tombstones.size() && tombstones[id])
+			{
+				it = bucket.erase(it);
+				removed++;
+			}
+			else
+				++it;
+		}
+
+		this->compact_cursor = (this->compact_cursor + 1) % this->capacity;
 	}
-	else if (algorithm == "Frechet")
+
+	this->size -= removed;
+	return removed;
+}
+
+template <typename Strategy>
+int hash_table<Strategy>::get_bucket_index(const Abstract_Object& p, uint32_t & object_id) const
+{
+	// objects not snapped to the grid are vectors, hashed as they are
+	if (!Strategy::snaps_to_grid)
+		return g(static_cast<const Object &>(p), this->capacity, object_id);
+
+	// we first apply the grid function h_delta to snap object to grid
+	const Abstract_Object * gridCurve = h_delta(p);
+	int index = g(*gridCurve, this->capacity, object_id);
+	delete gridCurve;
+
+	return index;
+}
+
+template <typename Strategy>
+void hash_table<Strategy>::rebuild(double bucket_load)
+{
+	// number of entries of each locality ID, entries of the same ID always share a bucket
+	std::unordered_map <uint32_t, int> id_counts;
+	for (int i = 0; i < this->capacity; ++i)
+		for (auto const& object_info : this->table[i])
+			id_counts[std::get<1>(object_info)]++;
+
+	if (id_counts.empty())
+		return;
+
+	int numBuckets = this->capacity;
+	if (bucket_load > 0)
+		numBuckets = std::max(1, (int) ceil(id_counts.size() / bucket_load));
+
+	// smallest largest bucket possible : the largest group of entries with the same ID, or the entries spread evenly
+	int largest_id = 0;
+	for (auto const& id_count : id_counts)
+		largest_id = std::max(largest_id, id_count.second);
+	int best_largest = std::max(largest_id, (this->size + numBuckets - 1) / numBuckets);
+
+	// if the IDs collide too much modulo numBuckets, try the next few numbers of buckets (with other prime factors)
+	int chosen = numBuckets;
+	int chosen_largest = largest_bucket(id_counts, numBuckets);
+	for (int attempt = 1; attempt <= REBUILD_ATTEMPTS && chosen_largest > REBUILD_SKEW * best_largest; ++attempt)
 	{
-		// we first apply the grid function h_delta to snap object to grid
-		const Abstract_Object * gridCurve = h_delta(p);
-		index = g(*gridCurve, this->capacity, object_id);
-		delete gridCurve;
+		int largest = largest_bucket(id_counts, numBuckets + attempt);
+		if (largest < chosen_largest)
+		{
+			chosen = numBuckets + attempt;
+			chosen_largest = largest;
+		}
 	}
 
-	return index;
+	if (chosen == this->capacity)
+		return;
+
+	// move the list nodes to their new buckets, entries keep their order within a bucket
+	std::list <std::pair <const Abstract_Object*, uint32_t> > * new_table = new std::list <std::pair <const Abstract_Object*, uint32_t> >[chosen];
+
+	for (int i = 0; i < this->capacity; ++i)
+		while (!this->table[i].empty())
+		{
+			auto first = this->table[i].begin();
+			std::list <std::pair <const Abstract_Object*, uint32_t> > & bucket = new_table[std::get<1>(*first) % chosen];
+			bucket.splice(bucket.end(), this->table[i], first);
+		}
+
+	delete[] this->table;
+	this->table = new_table;
+	this->capacity = chosen;
+	this->compact_cursor = 0;
 }
 
-const std::list <std::pair <const Abstract_Object*, uint32_t> > & hash_table::get_ith_bucket(int bucket_index) const
+template <typename Strategy>
+int hash_table<Strategy>::get_distinct_ids() const
+{
+	std::unordered_set <uint32_t> ids;
+	for (int i = 0; i < this->capacity; ++i)
+		for (auto const& object_info : this->table[i])
+			ids.insert(std::get<1>(object_info));
+
+	return ids.size();
+}
+
+template <typename Strategy>
+bucket_stats hash_table<Strategy>::get_stats() const
+{
+	std::vector <int> sizes(this->capacity);
+	for (int i = 0; i < this->capacity; ++i)
+		sizes[i] = this->table[i].size();
+
+	return get_bucket_stats(sizes);
+}
+
+template <typename Strategy>
+uint64_t hash_table<Strategy>::memory_usage() const
+{
+	typedef std::pair <const Abstract_Object*, uint32_t> entry;
+
+	// an empty list per bucket, and a list node (entry and two links) per entry
+	return (uint64_t) this->capacity * sizeof(std::list <entry>) + (uint64_t) this->size * (sizeof(entry) + 2 * sizeof(void*));
+}
+
+template <typename Strategy>
+const std::list <std::pair <const Abstract_Object*, uint32_t> > & hash_table<Strategy>::get_ith_bucket(int bucket_index) const
 {
 	return this->table[bucket_index];
-}
\ No newline at end of file
+}
+
+// the hash tables are compiled once for each strategy
+template class hash_table<vector_strategy>;
+template class hash_table<discrete_frechet_strategy>;
+template class hash_table<continuous_frechet_strategy>;
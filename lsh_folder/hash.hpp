@@ -5,11 +5,25 @@
 #include <list>
 #include <utility>
 #include <cstdint>
+#include <vector>
 #include "g_hash.hpp"
 #include "object.hpp"
 #include "h_grid.hpp"
+#include "dataset.hpp"
+#include "index_io.hpp"
+#include "index_params.hpp"
+#include "rng.hpp"
+#include "bucket_stats.hpp"
 
+// a table is skewed if its largest bucket holds more than REBUILD_SKEW times the entries it would hold at best
+// (all entries spread evenly, but the entries of the same locality ID kept together), it is then rebuilt with another number of buckets
+#define REBUILD_SKEW 2
+// number of other bucket counts tried for a skewed table, the one with the smallest largest bucket is kept
+#define REBUILD_ATTEMPTS 8
 
+// class hash_table is a hash table of objects, hashed by an amplified g hash function
+// Strategy (see strategies.hpp) defines whether objects are snapped to the grid h_delta before they are hashed
+template <typename Strategy>
 class hash_table
 {
 private:
@@ -17,17 +31,22 @@ private:
 	
 	int size;						// number of elements added
 	int capacity;					// number of buckets
+	int compact_cursor;				// bucket index where the next incremental compaction starts
 	g_hash g;						// amplified g hash function for hash table
 	h_grid h_delta;					// grid hash function used for time series similarity search (and maps points of dimension dim)
 
 
 public:
-	// constructor
+	// constructor, g and h_delta are randomly chosen using given generator
 	// dim is the dimension od the grid used. 
 	//	For this project a 2-dimension grid suffices since the snapping of an object is compatible even if
 	// grid has higher dimension than the object curve's complexity and in this project, the object curves will have complexity of either 1 or 2
 
-	hash_table(int numBuckets, int dim = 2);
+	hash_table(int numBuckets, const index_params & params, rng & generator, int dim = H_GRID_DIM);
+	// constructor through an index snapshot, reads g, h_delta and the bucket contents (as ids of given dataset's objects)
+	hash_table(index_reader & reader, const Dataset & dataset, const index_params & params);
+	// writes g, h_delta and the bucket contents (as object ids) to an index snapshot
+	void save(index_writer & writer) const;
 	// destructor
 	~hash_table();
 	// returns number of elements currently in hash table
@@ -35,13 +54,24 @@ public:
 	// returns number of buckets currently in hash table
 	int get_capacity() const;
 	// inserts given point-object into hash table
-	// complexity is the original complexity of the curves before they passed the filter
-	// (necessary for the query curves)
-	void insert(const Abstract_Object& p, int complexity = 0);
+	void insert(const Abstract_Object& p);
+	// removes from the buckets the entries of objects marked as removed in tombstones (indexed by object id)
+	// visits at most max_buckets buckets, starting where the previous call stopped, and returns the number of entries removed
+	int compact(const std::vector <bool> & tombstones, int max_buckets);
 	// returns bucket index in which given object p hashes in and its locality ID in object_id
-	int get_bucket_index(const Abstract_Object& p, uint32_t & object_id);
+	int get_bucket_index(const Abstract_Object& p, uint32_t & object_id) const;
+	// spreads the entries again over a new number of buckets (entries keep their locality IDs, so nothing is hashed again)
+	// if bucket_load > 0, the new number of buckets is the number of distinct locality IDs over bucket_load, otherwise the current one
+	// if the entries are badly skewed with that number of buckets, a few other numbers are tried (see REBUILD_SKEW)
+	void rebuild(double bucket_load);
+	// returns the number of distinct locality IDs of the entries
+	int get_distinct_ids() const;
+	// returns the occupancy statistics of the buckets
+	bucket_stats get_stats() const;
+	// returns the approximate number of bytes taken by the buckets and their entries
+	uint64_t memory_usage() const;
 	// returns bucket-list indicated by bucket index
 	const std::list <std::pair <const Abstract_Object*, uint32_t> > & get_ith_bucket(int bucket_index) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -4,15 +4,18 @@
 #include <set>
 #include <string>
 #include <chrono>
-#include <queue>
 #include <utility>
 #include <vector>
+#include <algorithm>
 #include <cstdint>
 #include "params.hpp"
 #include "lsh_struct.hpp"
 #include "hash.hpp"
 #include "dataset.hpp"
 #include "object.hpp"
+#include "query_budget.hpp"
+#include "top_k.hpp"
+#include "parallel.hpp"
 #include "fred/include/frechet.hpp"
 
 #if 1
@@ -30,47 +33,168 @@ Curve* transform_to_Fred_Curve(const Object& obj){
 }
 #endif
 
-lsh_struct::lsh_struct(int hash_table_size): curve_vect()//, complexity(-1)
+template <typename Strategy>
+lsh_struct<Strategy>::lsh_struct(const index_params & params, int hash_table_size, rng & generator): params(params), dead_entries(0), curve_vect()//, complexity(-1)
 {
 	// lsh_hash_struct is an array of pointers to L hash tables
-	lsh_hash_struct = new hash_table*[L];
+	lsh_hash_struct = new hash_table<Strategy>*[params.L];
 
-	for (int i = 0; i < L; ++i)
+	for (int i = 0; i < params.L; ++i)
 	{
-		lsh_hash_struct[i] = new hash_table(hash_table_size);
+		lsh_hash_struct[i] = new hash_table<Strategy>(hash_table_size, params, generator);
 	}
 }
 
-lsh_struct::~lsh_struct()
+template <typename Strategy>
+lsh_struct<Strategy>::lsh_struct(index_reader & reader, const Dataset & dataset, const index_params & params): params(params), dead_entries(0), curve_vect()
+{
+	// lsh_hash_struct is an array of pointers to L hash tables, each one read from the snapshot
+	lsh_hash_struct = new hash_table<Strategy>*[params.L];
+
+	for (int i = 0; i < params.L; ++i)
+	{
+		lsh_hash_struct[i] = new hash_table<Strategy>(reader, dataset, params);
+	}
+
+	// fred curves are not part of the snapshot, they are just copies of the dataset objects
+	if (Strategy::uses_fred)
+	{
+		for (int i = 0; i < dataset.get_num_of_Objects(); ++i)
+			curve_vect.push_back(transform_to_Fred_Curve(dynamic_cast<const Object&>(dataset.get_ith_object(i))));
+	}
+}
+
+template <typename Strategy>
+lsh_struct<Strategy>::~lsh_struct()
 {
 	for (long unsigned int i = 0 ; i  < curve_vect.size() ; i++){
 		delete curve_vect[i];
 	}
-	for (int i = 0; i < L; ++i)
+	for (int i = 0; i < this->params.L; ++i)
 		delete lsh_hash_struct[i];
 
 	delete[] lsh_hash_struct;
 }
 
-void lsh_struct::import_data(const Dataset & dataset)
+template <typename Strategy>
+void lsh_struct<Strategy>::import_data(const Dataset & dataset)
 {
 	int num_of_Objects = dataset.get_num_of_Objects();
 
 	for (int i = 0; i < num_of_Objects; ++i)					// for each of the point_objects
 	{
 		const Abstract_Object& abstract_obj = dataset.get_ith_object(i);
-		if (algorithm == "Frechet" && metric_func == "continuous"){
+		if (Strategy::uses_fred){
 			curve_vect.push_back(transform_to_Fred_Curve(dynamic_cast<const Object&>(abstract_obj)));
 		}
-		for (int j = 0; j < L; ++j)		// for each of the L hashtables
+		for (int j = 0; j < this->params.L; ++j)		// for each of the L hashtables
 		{
 			(this->lsh_hash_struct[j])->insert(abstract_obj); // insert object into hash-table
 		}
 	}
 
+	// number of buckets is set once the locality IDs of the dataset are known (and changed if they collide too much)
+	for (int j = 0; j < this->params.L; ++j)
+		(this->lsh_hash_struct[j])->rebuild(this->params.bucket_load);
+}
+
+template <typename Strategy>
+bool lsh_struct<Strategy>::save_index(const std::string & index_file, const Dataset & dataset) const
+{
+	index_writer writer(index_file);
+
+	if (!writer.is_open())		// check if file was opened properly
+		return false;
+
+	write_index_header(writer, "LSH", Strategy::snaps_to_grid ? "Frechet" : "LSH", Strategy::metric(), dataset.get_num_of_Objects(), this->params);
+
+	for (int i = 0; i < this->params.L; ++i)
+		(this->lsh_hash_struct[i])->save(writer);
+
+	return writer.good();
+}
+
+template <typename Strategy>
+void lsh_struct<Strategy>::insert(const Abstract_Object & object)
+{
+	if (Strategy::uses_fred){
+		curve_vect.push_back(transform_to_Fred_Curve(dynamic_cast<const Object&>(object)));	// curve_vect is indexed by object id too
+	}
+	for (int j = 0; j < this->params.L; ++j)		// for each of the L hashtables
+	{
+		(this->lsh_hash_struct[j])->insert(object); // insert object into hash-table
+	}
+
+	this->compaction_step();
+}
+
+template <typename Strategy>
+void lsh_struct<Strategy>::remove(const Abstract_Object & object)
+{
+	int id = object.get_id();
+
+	if (id < 0 || this->is_removed(object))		// object not in dataset, or already removed
+		return;
+
+	if (id >= (int) this->tombstones.size())
+		this->tombstones.resize(id + 1, false);
+
+	// searches skip the object at once, its L entries are erased later on by the compaction steps
+	this->tombstones[id] = true;
+	this->dead_entries += this->params.L;
+
+	this->compaction_step();
+}
+
+template <typename Strategy>
+void lsh_struct<Strategy>::compact()
+{
+	for (int j = 0; j < this->params.L; ++j)
+		this->dead_entries -= (this->lsh_hash_struct[j])->compact(this->tombstones, (this->lsh_hash_struct[j])->get_capacity());
+}
+
+template <typename Strategy>
+uint64_t lsh_struct<Strategy>::memory_usage() const
+{
+	// each g is k h functions (a vector v and t) and k coefficients r
+	uint64_t hash_functions = (uint64_t) this->params.k * ((Strategy::key_dim(this->params.dim) + 1) * sizeof(float) + sizeof(int));
+	uint64_t bytes = 0;
+
+	for (int i = 0; i < this->params.L; ++i)
+		bytes += hash_functions + (this->lsh_hash_struct[i])->memory_usage();
+
+	return bytes;
+}
+
+template <typename Strategy>
+void lsh_struct<Strategy>::print_stats(std::ostream & out) const
+{
+	for (int i = 0; i < this->params.L; ++i)
+	{
+		out << "Hash table " << i + 1 << " : " << (this->lsh_hash_struct[i])->get_distinct_ids() << " locality IDs, ";
+		print_bucket_stats(out, "", (this->lsh_hash_struct[i])->get_stats());
+	}
+}
+
+template <typename Strategy>
+bool lsh_struct<Strategy>::is_removed(const Abstract_Object & object) const
+{
+	int id = object.get_id();
+	return id >= 0 && id < (int) this->tombstones.size() && this->tombstones[id];
+}
+
+template <typename Strategy>
+void lsh_struct<Strategy>::compaction_step()
+{
+	if (this->dead_entries == 0)	// nothing to compact
+		return;
+
+	for (int j = 0; j < this->params.L; ++j)
+		this->dead_entries -= (this->lsh_hash_struct[j])->compact(this->tombstones, COMPACTION_STEP);
 }
 
-bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+bool lsh_struct<Strategy>::execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R)
 {
 
 	std::ofstream file (output_file, std::ios::out);		// open output file for output operations
@@ -89,22 +213,19 @@ bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset,
 	double tTrueAvg = 0;
 	double max_AF = 0;
 	int not_found = 0;
+	int truncated_queries = 0;
 
 	for (int i = 0; i < num_of_Objects; i++)		// run for each of the query Objects
 	{
 		file << "Query: query Object " << (query_dataset.get_ith_object(i)).get_name() << "\n";
-		if (algorithm == "LSH")
-			file << "Algorithm: LSH_Vector  \n\n";
-		else if (algorithm == "Frechet" && metric_func == "discrete")
-			file << "Algorithm: LSH_Frechet_Discrete  \n\n";
-		else if (algorithm == "Frechet" && metric_func == "continuous")
-			file << "Algorithm: LSH_Frechet_Continuous  \n\n";
+		file << "Algorithm: LSH_" << Strategy::name() << "  \n\n";
 
 		//start timer for lsh
 		auto t_lsh_start = std::chrono::high_resolution_clock::now();
 		
-		// run approximate nearest neighbors and return the neighbors and the distances found
-		std::vector <std::pair <double, const Abstract_Object*> > appr_nearest = this->appr_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, metric);
+		// run approximate nearest neighbors and return the neighbors and the distances found (stopped at the query budget)
+		bool truncated = false;
+		std::vector <std::pair <double, const Abstract_Object*> > appr_nearest = this->appr_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, &truncated);
 		
 		// end timer for lsh
 		auto t_lsh_end = std::chrono::high_resolution_clock::now();
@@ -113,7 +234,7 @@ bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset,
 		auto t_true_start = std::chrono::high_resolution_clock::now();
 
 		// run exact nearest neighbors and return the neighbors and the distances found
-		std::vector <std::pair <double, const Abstract_Object*> > exact_nearest = this->exact_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N, metric);
+		std::vector <std::pair <double, const Abstract_Object*> > exact_nearest = this->exact_nearest_neighbors(dataset, query_dataset.get_ith_object(i), N);
 		
 		// end timer for brute force
 		auto t_true_end = std::chrono::high_resolution_clock::now();
@@ -157,6 +278,13 @@ bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset,
 			}
 		}
 
+		// queries stopped by their budget are marked, their neighbors are the best found until then
+		if (truncated)
+		{
+			file << "Truncated : query budget reached\n\n";
+			truncated_queries++;
+		}
+
 		// get execution for LSH in milliseconds 
 	    std::chrono::duration <double, std::milli> tLSH = t_lsh_end - t_lsh_start;
 	    // get execution for brute force in milliseconds
@@ -174,7 +302,7 @@ bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset,
 			file << "R-near neighbors: (R = " << R << ")" << '\n';
 
 			// run approximate range search and write results into file
-			std::list <std::pair <double, const Abstract_Object*> > R_list = this->range_search(query_dataset.get_ith_object(i), R, metric);
+			std::list <std::pair <double, const Abstract_Object*> > R_list = this->range_search(query_dataset.get_ith_object(i), R);
 			std::list <std::pair <double, const Abstract_Object*> > ::iterator it = R_list.begin();
 
 			while (it != R_list.end()){
@@ -197,22 +325,25 @@ bool lsh_struct::execute(const Dataset & dataset, const Dataset & query_dataset,
 	std::cout << "Max AF = " << max_AF << std::endl;
 	std::cout << "Average AF = " << avg_AF / (N * num_of_Objects - not_found) << std::endl;
 	std::cout << "Average Time Fraction (LSH/True) = " << avg_TF/num_of_Objects << std::endl;
+	std::cout << "Truncated queries = " << truncated_queries << std::endl;
 	std::cout << "Not found = " << not_found << std::endl << std::endl;
 
 	return true;
 }
 
-std::vector <std::pair <double, const Abstract_Object*> > lsh_struct::appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+std::vector <std::pair <double, const Abstract_Object*> > lsh_struct<Strategy>::appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, bool * truncated)
 {
-	// run approximate kNN
+	// run approximate kNN, within the query budget (each hash table probed is a probe)
+	query_budget budget(this->params);
 
 	// initialize an empty set of strings-object names, that will serve as a visited set, so that we check each object at most once
 	std::set <std::string> visited_set;
 
-	// initialize a max heap priority queue, that will store the distance of Object from query object and a pointer to the Object itself
-	std::priority_queue <std::pair <double, const Abstract_Object*> > max_heap;
+	// the N nearest objects found so far, with their distances from the query object
+	top_k nearest(N);
 
-	for (int i = 0; i < L; ++i)
+	for (int i = 0; i < this->params.L && budget.probe(); ++i)
 	{
 		uint32_t query_object_id = 0;
 
@@ -225,102 +356,84 @@ std::vector <std::pair <double, const Abstract_Object*> > lsh_struct::appr_neare
 			const Abstract_Object * object = std::get<0>(object_info);			// get object
 			uint32_t object_id = std::get<1>(object_info);						// get object's locality ID
 
+			if (this->is_removed(*object))		// skip entries of removed objects not compacted yet
+				continue;
+
 			// if given object has not been visited yet and has same locality ID with query object
 			if (visited_set.count(object->get_name()) == 0 && object_id == query_object_id)
 			{
+				if (!budget.distance())		// budget spent, keep the neighbors found so far
+					break;
+
 				// add object's name (unique identifier) into visited set
 				visited_set.insert(object->get_name());
-				// calculate object's distance from query object
-				double dist = (*metric)(query_object, *object);
-
-				if ((int) max_heap.size() < N)	// if we haven't found N neighbors yet
-					max_heap.push(std::make_pair(dist, object));	// simply push the new object-neighbor found
-				else
-				{
-					// N neighbors have already been found, so compare with largest distance
-					double largest_dist = std::get<0>(max_heap.top());
-
-					if (dist < largest_dist)	// if new object is closer
-					{
-						max_heap.pop();									// pop the Object with the largest distance
-						max_heap.push(std::make_pair(dist, object));	// and insert the new object
-					}
-				}
+				// calculate object's distance from query object (abandoned once it exceeds the N-th neighbor found so far, push rejects it then)
+				double dist = Strategy::bounded_distance(query_object, *object, nearest.bound());
+				nearest.push(dist, object);		// kept if it is closer than the N-th neighbor found so far
 			}
 		}
 	}
 
-	// initialize a vector with how many approximate nearest neighbors were found
-	std::vector <std::pair <double, const Abstract_Object*> > nearest(max_heap.size());
-
-	for (int i = nearest.size() - 1; i >= 0; --i)	// for each nearest neighbor found
-	{
-		nearest[i] = max_heap.top();	// save nearest neighbor
-		max_heap.pop();
-	}
+	if (truncated != nullptr)
+		*truncated = budget.is_truncated();
 	
-	return nearest;
+	return nearest.sorted();
 }
 
-std::vector <std::pair <double, const Abstract_Object*> > lsh_struct::exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+std::vector <std::pair <double, const Abstract_Object*> > lsh_struct<Strategy>::exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N)
 {
 	// run brute force exact kNN
 	int num_of_Objects = dataset.get_num_of_Objects();
 	Curve* fred_curve = nullptr;
-	if (algorithm == "Frechet" && metric_func == "continuous"){
+	if (Strategy::uses_fred){
 		fred_curve = transform_to_Fred_Curve(dynamic_cast<const Object&> (query_object));
 	}
-	// initialize a max heap priority queue, that will store the distance of Object from query object and a pointer to the Object itself
-	std::priority_queue <std::pair <double, const Abstract_Object*> > max_heap;
 
-	// check each of the dataset objects by brute force
-	for (int i = 0; i < num_of_Objects; ++i)
+	// dataset objects are split into contiguous chunks, each thread keeps the N nearest objects of its chunk
+	int threads = parallel_threads(num_of_Objects, Strategy::snaps_to_grid ? BRUTE_FORCE_CURVE_CHUNK : BRUTE_FORCE_CHUNK);
+	std::vector <top_k> partial(threads, top_k(N));
+
+	parallel_for(num_of_Objects, threads, [&](int begin, int end, int thread)
 	{
-		double dist = 0;
-		if (algorithm == "Frechet" && metric_func == "continuous"){
-			if (fred_curve->complexity() >= 2 && curve_vect[i]->complexity() >= 2){
-				dist = (Frechet::Continuous::distance(*(curve_vect[i]), *fred_curve)).value;
-			}
-			else{
-				std::cerr << " A fred curve has complexity 1" << std::endl; 
-				dist = (*metric)(query_object, dataset.get_ith_object(i));
-			}
-		}
-		else {
-			// find its distance from query object
-			dist = (*metric)(query_object, dataset.get_ith_object(i));
-		}
-		if ((int) max_heap.size() < N)	// if we haven't found N neighbors yet
-			max_heap.push(std::make_pair(dist, & dataset.get_ith_object(i)));
-		else
+		// check each of the dataset objects of the chunk by brute force
+		for (int i = begin; i < end; ++i)
 		{
-			// N neighbors have already been found, so compare with largest distance
-			double largest_dist = std::get<0>(max_heap.top());
+			if (dataset.is_removed(i))		// skip removed objects
+				continue;
 
-			if (dist < largest_dist)	// if new object is closer
-			{
-				max_heap.pop();									// pop the Object with the largest distance
-				max_heap.push(std::make_pair(dist, & dataset.get_ith_object(i)));	// and insert the new object
+			double dist = 0;
+			if (Strategy::uses_fred){
+				if (fred_curve->complexity() >= 2 && curve_vect[i]->complexity() >= 2){
+					dist = (Frechet::Continuous::distance(*(curve_vect[i]), *fred_curve)).value;
+				}
+				else{
+					std::cerr << " A fred curve has complexity 1" << std::endl; 
+					dist = Strategy::bounded_distance(query_object, dataset.get_ith_object(i), partial[thread].bound());
+				}
+			}
+			else {
+				// find its distance from query object (abandoned once it exceeds the N-th nearest object of the chunk so far)
+				dist = Strategy::bounded_distance(query_object, dataset.get_ith_object(i), partial[thread].bound());
 			}
+			partial[thread].push(dist, & dataset.get_ith_object(i));
 		}
-	}
+	});
 
-	// initialize a vector with how many exact nearest neighbors were found
-	std::vector <std::pair <double, const Abstract_Object*> > nearest(max_heap.size());
+	// the N nearest of the partial results are the N nearest objects of the dataset
+	top_k nearest(N);
+	for (auto const& thread_nearest : partial)
+		nearest.merge(thread_nearest);
 
-	for (int i = nearest.size() - 1; i >= 0; --i)	// for each nearest neighbor found
-	{
-		nearest[i] = max_heap.top();	// save nearest neighbor
-		max_heap.pop();
-	}
-	if (algorithm == "Frechet" && metric_func == "continuous"){
+	if (Strategy::uses_fred){
 		delete fred_curve;
 	}
-	return nearest;
+	return nearest.sorted();
 }
 
 
-std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search(const Abstract_Object & query_object, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &), const int R2)
+template <typename Strategy>
+std::list <std::pair <double, const Abstract_Object*> > lsh_struct<Strategy>::range_search(const Abstract_Object & query_object, const int & R, const int R2)
 {
 
 	std::set<std::string> visited_set;
@@ -328,7 +441,7 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 	//Save all object-points who are within radius R of the query_object
 	std::list<std::pair <double, const Abstract_Object*> > R_list;
 
-	for (int i = 0; i < L; ++i)
+	for (int i = 0; i < this->params.L; ++i)
 	{
 		uint32_t query_object_id = 0;
 
@@ -340,13 +453,16 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 		{
 			const Abstract_Object * object = std::get<0>(object_info);			// get object
 
+			if (this->is_removed(*object))		// skip entries of removed objects not compacted yet
+				continue;
+
 			// if current object has not been visited yet
 			if (visited_set.count(object->get_name()) == 0)
 			{
 				// add object's name (unique identifier) into visited set
 				visited_set.insert(object->get_name());
 
-				double dist = (*metric)(query_object, *object);
+				double dist = Strategy::distance(query_object, *object);
 				//if it is also within range
 				if (R2 <= dist && dist < R )
 				{
@@ -361,7 +477,8 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 
 
 
-std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search_with_set(const Abstract_Object & query_object, const int & R, std::set<std::string> & already_visited , double (*metric)(const Abstract_Object &, const Abstract_Object &))
+template <typename Strategy>
+std::list <std::pair <double, const Abstract_Object*> > lsh_struct<Strategy>::range_search_with_set(const Abstract_Object & query_object, const int & R, std::set<std::string> & already_visited )
 {
 
 	std::set<std::string> visited_set;
@@ -369,7 +486,7 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 	//Save all object-points who are within radius R of the query_object
 	std::list<std::pair <double, const Abstract_Object*> > R_list;
 
-	for (int i = 0; i < L; ++i)
+	for (int i = 0; i < this->params.L; ++i)
 	{
 		uint32_t query_object_id = 0;
 
@@ -380,6 +497,9 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 		for (auto const& object_info : (this->lsh_hash_struct[i])->get_ith_bucket(bucket))
 		{
 			const Abstract_Object * object = std::get<0>(object_info);			// get object
+
+			if (this->is_removed(*object))		// skip entries of removed objects not compacted yet
+				continue;
 			
 			if (already_visited.count(object->get_name()) != 0){
 				continue;
@@ -394,7 +514,7 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 				// add object's name (unique identifier) into visited set
 				visited_set.insert(object->get_name());
 
-				double dist = (*metric)(query_object, *object);
+				double dist = Strategy::distance(query_object, *object);
 				//if it is also within range
 				if (dist < R )
 				{
@@ -405,4 +525,35 @@ std::list <std::pair <double, const Abstract_Object*> > lsh_struct::range_search
 	}
 
 	return R_list;
-}
\ No newline at end of file
+}
+
+template <typename Strategy>
+std::vector <const Abstract_Object*> lsh_struct<Strategy>::bucket_objects(const Abstract_Object & query_object) const
+{
+	std::vector <const Abstract_Object*> objects;
+
+	for (int i = 0; i < this->params.L; ++i)
+	{
+		uint32_t query_object_id = 0;
+
+		// get bucket index in i-th hash table, for given query object
+		int bucket = (this->lsh_hash_struct[i])->get_bucket_index(query_object, query_object_id);
+
+		for (auto const& object_info : (this->lsh_hash_struct[i])->get_ith_bucket(bucket))
+		{
+			if (!this->is_removed(*std::get<0>(object_info)))		// skip entries of removed objects not compacted yet
+				objects.push_back(std::get<0>(object_info));
+		}
+	}
+
+	// an object may be in the bucket of the query object in several hashtables
+	std::sort(objects.begin(), objects.end());
+	objects.erase(std::unique(objects.begin(), objects.end()), objects.end());
+
+	return objects;
+}
+
+// lsh is compiled once for each strategy
+template class lsh_struct<vector_strategy>;
+template class lsh_struct<discrete_frechet_strategy>;
+template class lsh_struct<continuous_frechet_strategy>;
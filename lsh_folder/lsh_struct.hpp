@@ -10,20 +10,37 @@
 #include "dataset.hpp"
 #include "object.hpp"
 #include "search_method.hpp"
+#include "index_io.hpp"
+#include "index_params.hpp"
+#include "strategies.hpp"
+#include "rng.hpp"
 #include <set>
 
 // using the fred library to store Curves
 // But only used in continuous frechet and when an input curve is filtered then make a copy of it but of Class Curve
 #include "fred/include/curve.hpp"
 
+// returns a copy of given object as a curve of the fred library (each coordinate is a 1-dimensional point)
+Curve* transform_to_Fred_Curve(const Object& obj);
+
 
 
 // class lsh_struct contains all the data structures used by lsh
 // namely L hash-tables
+// Strategy (see strategies.hpp) defines how objects are hashed and the metric used to compare them
+template <typename Strategy>
 class lsh_struct : public search_method
 {
 private:
-	hash_table ** lsh_hash_struct;	// an array of pointers to L hashtables
+	index_params params;			// parameters lsh struct was built with
+	hash_table<Strategy> ** lsh_hash_struct;	// an array of pointers to L hashtables
+	std::vector<bool> tombstones;	// tombstones[id] is true if the object with that id was removed from lsh struct
+	int dead_entries;				// number of entries of removed objects still left in the buckets of the L hashtables
+
+	// returns true if given object was removed from lsh struct (its entries may not be compacted away yet)
+	bool is_removed(const Abstract_Object & object) const;
+	// compacts a few buckets of each hashtable, if there are entries of removed objects left
+	void compaction_step();
 	
 
 	std::vector<Curve*> curve_vect; // Used to store the input data as curves of the fred library for
@@ -37,30 +54,50 @@ private:
 										// Then it is impossible to be inserted into the vector LSH
 										// Thus keep the original input curve complexity
 public:
-	// constructor, creates the L hashtables, each with number of buckets = hash_table_size
-	lsh_struct(int hash_table_size);
+	// constructor, creates the L hashtables, each with number of buckets = hash_table_size, their hash functions are drawn from given generator
+	lsh_struct(const index_params & params, int hash_table_size, rng & generator);
+	// constructor through an index snapshot (after its header), reads the L hashtables built on given dataset
+	lsh_struct(index_reader & reader, const Dataset & dataset, const index_params & params);
 	~lsh_struct();
 	// imports dataset objects into lsh struct (into the L hash tables)
 	void import_data(const Dataset & dataset);
 
-	// executes the approximate/exact/ranged nearest neighbors algorithms using given metric function (pointer to function)
+	// writes the L hashtables to an index snapshot file
+	bool save_index(const std::string & index_file, const Dataset & dataset) const;
+
+	// inserts a single object into the L hashtables
+	void insert(const Abstract_Object & object);
+	// removes a single object from lsh struct (tombstone, compacted away incrementally by the updates that follow)
+	void remove(const Abstract_Object & object);
+	// compacts away at once all entries of removed objects
+	void compact();
+	// returns the approximate number of bytes taken by the L hashtables and their hash functions
+	uint64_t memory_usage() const;
+	// prints the occupancy statistics of the buckets of each hashtable
+	void print_stats(std::ostream & out) const;
+
+	// executes the approximate/exact/ranged nearest neighbors algorithms
 	// and outputs results and execution times in output file
-	bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	bool execute(const Dataset & dataset, const Dataset & query_dataset, const std::string & output_file, const int & N, const int & R);
 
-	// runs approximate nearest neighbors using given metric function and returns an array of nearest neighbors and distances found
-	std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	// runs approximate nearest neighbors and returns an array of nearest neighbors and distances found
+	std::vector <std::pair <double, const Abstract_Object*> > appr_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, bool * truncated = nullptr);
 
-	// runs exact nearest neighbors using given metric function and returns an array of nearest neighbors and distances found
-	std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	// runs exact nearest neighbors and returns an array of nearest neighbors and distances found
+	std::vector <std::pair <double, const Abstract_Object*> > exact_nearest_neighbors(const Dataset & dataset, const Abstract_Object & query_object, const int & N);
 
-	// runs approximate range search using given metric function 
+	// runs approximate range search
 	//There is another parameter R2. Given R and R2, this function actually only stores in the set points which belong to the ring [R2, R) with center the query_object
 	// Here by ring [r, R) with center C is the set of points with r <= dist < R where dist is the distance of the point from the center
 	// By default R2 is 0 so the ring [0, R) is acually the ball with radius R 
-	std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, double (*metric)(const Abstract_Object &, const Abstract_Object &), const int R2 = 0);
+	std::list <std::pair <double, const Abstract_Object*> > range_search(const Abstract_Object & query_object, const int & R, const int R2 = 0);
 	
 
-	std::list <std::pair <double, const Abstract_Object*> > range_search_with_set(const Abstract_Object & query_object, const int & R, std::set<std::string> & already_visited, double (*metric)(const Abstract_Object &, const Abstract_Object &));
+	std::list <std::pair <double, const Abstract_Object*> > range_search_with_set(const Abstract_Object & query_object, const int & R, std::set<std::string> & already_visited);
+
+	// returns the distinct objects in the buckets of given query object in the L hashtables
+	// i.e. the objects a range search of it checks, whatever the radius
+	std::vector <const Abstract_Object*> bucket_objects(const Abstract_Object & query_object) const;
 };
 
 #endif
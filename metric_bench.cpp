@@ -0,0 +1,141 @@
+//file:metric_bench.cpp//
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "params.hpp"
+#include "object.hpp"
+#include "strategies.hpp"
+#include "rng.hpp"
+
+// microbenchmark of the per distance overhead of the metric dispatch
+// compares the metric wrappers (call through a function pointer, then a virtual call and a dynamic_cast, as the search loops did)
+// to the typed metric of each strategy (static_cast and a direct call, as the search and clustering templates do now)
+//
+// usage : ./metric_bench [-n <objects>] [-d <dimension>] [-rounds <rounds>] [-seed <int>]
+
+// global program parameters (not used by the metrics, but declared by params.hpp)
+int k, L, d = 0, d1, w, n = 0, probes, M, K;
+std::string algorithm, metric_func;
+double delta, epsilon = 0.01;
+
+// metric used through a pointer, as it was given to the search structures
+typedef double (*metric_function)(const Abstract_Object &, const Abstract_Object &);
+
+// computes the distance of each object to every object, rounds times, through the metric pointer
+// returns the sum of all distances (so that the work is not optimized away) and the time taken in ns per distance
+static double run_pointer(const std::vector <Abstract_Object*> & objects, metric_function metric, int rounds, double & ns_per_distance)
+{
+	double sum = 0.0;
+	int num_of_objects = objects.size();
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (int i = 0; i < num_of_objects; ++i)
+			for (int j = 0; j < num_of_objects; ++j)
+				sum += (*metric)(*objects[i], *objects[j]);
+	auto t_end = std::chrono::high_resolution_clock::now();
+
+	std::chrono::duration <double, std::nano> time = t_end - t_start;
+	ns_per_distance = time.count() / ((double) rounds * num_of_objects * num_of_objects);
+
+	return sum;
+}
+
+// same as above, through the typed metric of given strategy
+template <typename Strategy>
+static double run_strategy(const std::vector <Abstract_Object*> & objects, int rounds, double & ns_per_distance)
+{
+	double sum = 0.0;
+	int num_of_objects = objects.size();
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (int r = 0; r < rounds; ++r)
+		for (int i = 0; i < num_of_objects; ++i)
+			for (int j = 0; j < num_of_objects; ++j)
+				sum += Strategy::distance(*objects[i], *objects[j]);
+	auto t_end = std::chrono::high_resolution_clock::now();
+
+	std::chrono::duration <double, std::nano> time = t_end - t_start;
+	ns_per_distance = time.count() / ((double) rounds * num_of_objects * num_of_objects);
+
+	return sum;
+}
+
+// runs both versions of a metric and prints a line with their times per distance
+template <typename Strategy>
+static void compare(const std::string & name, const std::vector <Abstract_Object*> & objects, metric_function metric, int rounds)
+{
+	double ns_pointer = 0.0, ns_strategy = 0.0;
+
+	// warm up caches and allocator with a single round of each
+	run_pointer(objects, metric, 1, ns_pointer);
+	run_strategy<Strategy>(objects, 1, ns_strategy);
+
+	double sum_pointer = run_pointer(objects, metric, rounds, ns_pointer);
+	double sum_strategy = run_strategy<Strategy>(objects, rounds, ns_strategy);
+
+	std::cout << name << "\t" << ns_pointer << " ns\t" << ns_strategy << " ns\t" << ns_pointer - ns_strategy << " ns";
+	if (sum_pointer != sum_strategy)
+		std::cout << "\t(results differ)";
+	std::cout << std::endl;
+}
+
+int main(int argc, char const *argv[])
+{
+	int num_of_objects = 300, dim = 20, rounds = 5;
+	long long seed = 1;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string flag = argv[i];
+
+		if (flag == "-n")
+			num_of_objects = atoi(argv[i+1]);
+		else if (flag == "-d")
+			dim = atoi(argv[i+1]);
+		else if (flag == "-rounds")
+			rounds = atoi(argv[i+1]);
+		else if (flag == "-seed")
+			seed = atoll(argv[i+1]);
+		else
+		{
+			std::cerr << "\nUsage : ./metric_bench -n <objects> -d <dimension> -rounds <rounds> -seed <int>\n\n";
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (num_of_objects < 1 || dim < 1 || rounds < 1)
+	{
+		std::cerr << "\nObjects, dimension and rounds should be positive integers\n\n";
+		return EXIT_FAILURE;
+	}
+
+	rng generator(seed);
+
+	// random vectors, used as points and as time series of complexity dim
+	std::vector <Abstract_Object*> vectors, curves;
+	for (int i = 0; i < num_of_objects; ++i)
+	{
+		std::vector <float> coordinates(dim);
+		for (int j = 0; j < dim; ++j)
+			coordinates[j] = generator.uniform(0.0, 100.0);
+
+		vectors.push_back(new Object(coordinates));
+		curves.push_back(new time_series(coordinates));
+	}
+
+	std::cout << "metric\t\t\tpointer\t\ttyped\t\toverhead (per distance)\n";
+	compare<vector_strategy>("euclidean\t\t", vectors, euclidean, rounds);
+	compare<continuous_frechet_strategy>("discrete frechet (vector)", vectors, discrete_frechet, rounds);
+	compare<discrete_frechet_strategy>("discrete frechet (curve)", curves, discrete_frechet, rounds);
+
+	for (int i = 0; i < num_of_objects; ++i)
+	{
+		delete vectors[i];
+		delete curves[i];
+	}
+
+	return EXIT_SUCCESS;
+}
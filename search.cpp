@@ -12,6 +12,14 @@
 #include "lsh_struct.hpp"
 #include "hypercube_class.hpp"
 #include "assist_functions.hpp"
+#include "query_server.hpp"
+#include "index_update.hpp"
+#include "rng.hpp"
+#include "index_io.hpp"
+#include "index_params.hpp"
+#include "strategies.hpp"
+#include "tuner.hpp"
+#include "parallel.hpp"
 
 // main for curve similarity search
 // uses 1)vector_lsh, 2)vector_hypercube, 3)curve_lsh(frechet) for time series
@@ -23,21 +31,83 @@ int d1, probes, M;					// vector hypercube
 double delta, epsilon = 0.01;		// curve lsh (frechet)
 std::string algorithm, metric_func;	// variable for algorithm , metric used for frechet
 
+// returns the window of the h hash functions used by given algorithm, when none is given through a tuned file
+static int default_window(const std::string & algorithm)
+{
+	if (algorithm == "LSH")
+		return 20;			// experimental value (testing required)
+	else if (algorithm == "Hypercube")
+		return 50;			// experimental value (testing required)
+	else if (algorithm == "Frechet")
+		return 40;			// experimental value (testing required)
+	else
+		return 30;			// experimental value (testing required)
+}
+
 int main(int argc, char const *argv[])
 {
 	// variables for program input files
 	std::string input_file, query_file, output_file;
-	
-	srand(time(NULL));
+	// server mode : empty for the interactive mode, stdio or a unix domain socket path to keep the index warm and serve queries
+	std::string server;
+	// index snapshot files : to load the index from (instead of importing the dataset), and to save the built index to
+	std::string load_index, save_index;
+	// delta file : inserts and removes to apply to the index once it is built
+	std::string delta_file;
+	// seed of the random generator used to build the hash functions (negative if not given)
+	long long seed;
+	// order the hypercube vertices are probed in : hamming (increasing hamming distance) or query (query-directed)
+	std::string probe_order;
+	// tuning files : to write the parameters chosen by a tuning run to, and to read the parameters of a previous tuning run from
+	std::string tune_file, tuned_file;
+	// distinct locality IDs per bucket the lsh hash tables are resized to, once the dataset is imported (0 if not given)
+	double bucket_load;
+	// query budget of each approximate kNN query : distances evaluated, buckets (or vertices) probed, milliseconds (0 for no limit)
+	int max_distances, max_probes;
+	double deadline_ms;
+	// number of threads of the exact (brute force) searches (0 for as many as the hardware threads)
+	int threads;
 
 	// check for input args and initialize them
-	if (!check_init_args(argc, argv, input_file, query_file, k, d1, L, M, probes, output_file, algorithm, metric_func, delta))
+	if (!check_init_args(argc, argv, input_file, query_file, k, d1, L, M, probes, output_file, algorithm, metric_func, delta, server, load_index, save_index, delta_file, seed, probe_order, tune_file, tuned_file, bucket_load, max_distances, max_probes, deadline_ms, threads))
 	{
 		std::cerr << "\nWrong command line input. Use : ./search -i <input_file> -q <query_file> -k <int> -L <int> -M <int> -probes <int> ";
-		std::cerr << "-o <output_file> -algorithm <LSH / Hypercube / Frechet> -metric <discrete / continuous> -delta <double>\n";
-		std::cerr << "Each -x <value> pair is optional.  -metric to be used only for -algorithm Frechet\n\n";
+		std::cerr << "-o <output_file> -algorithm <LSH / Hypercube / Frechet> -metric <discrete / continuous> -delta <double> -server <stdio / socket_path> ";
+		std::cerr << "-load-index <index_file> -save-index <index_file> -delta-file <delta_file> -seed <int> -probe-order <hamming / query> -tune <tuned_file> -tuned <tuned_file> -bucket-load <double> -max-distances <int> -max-probes <int> -deadline <ms> -threads <int>\n";
+		std::cerr << "Each -x <value> pair is optional.  -metric to be used only for -algorithm Frechet or Hypercube.  -delta-file not to be used with -save-index\n";
+		std::cerr << "-tune not to be used with -load-index, -server or -tuned\n\n";
 		return EXIT_FAILURE;
 	}
+
+	// parameters of a previous tuning run replace the default ones (window and delta are set once the algorithm is known)
+	int tuned_w = 0;
+	double tuned_delta = 0.0;
+	if (!tuned_file.empty())
+	{
+		std::string tuned_algorithm, tuned_metric;
+		if (!read_tuned_file(tuned_file, tuned_algorithm, tuned_metric, k, L, d1, M, probes, tuned_w, tuned_delta))
+			return EXIT_FAILURE;
+
+		if (!algorithm.empty() && algorithm != tuned_algorithm)
+		{
+			std::cerr << "\nGiven tuned file was tuned for algorithm " << tuned_algorithm << ", it does not match the algorithm given\n\n";
+			return EXIT_FAILURE;
+		}
+		algorithm = tuned_algorithm;
+		metric_func = tuned_metric;
+		if (tuned_delta > 0)
+			delta = tuned_delta;
+	}
+
+	if (threads > 0)
+		set_num_threads(threads);
+
+	// a single generator, seeded once, is used for every random choice of the index (same seed gives the same index)
+	rng generator(seed >= 0 ? (uint64_t) seed : random_seed());
+
+	// when serving on stdin/stdout, stdout carries only the responses, so progress messages go to stderr
+	if (server == "stdio")
+		std::cout.rdbuf(std::cerr.rdbuf());
 	
 	//ask for input path, if not given through command line
 	if (input_file.empty())
@@ -54,6 +124,34 @@ int main(int argc, char const *argv[])
 		return EXIT_FAILURE;
 	}
 
+	// snapshot of an index built in a previous run, if one is given
+	index_reader * snapshot = nullptr;
+	std::string structure;
+	index_params params = global_index_params();		// M and probes are not part of a snapshot, they stay as given
+
+	if (!load_index.empty())
+	{
+		std::string given_algorithm = algorithm;
+		int index_n = 0;
+
+		snapshot = new index_reader(load_index);
+
+		// the snapshot header sets the algorithm and the parameters the index was built with
+		if (!snapshot->is_open() || !read_index_header(*snapshot, structure, algorithm, metric_func, index_n, params))
+		{
+			std::cerr << "\nGiven index file could not be read (invalid file path or not an index snapshot)\n\n";
+			delete snapshot;
+			return EXIT_FAILURE;
+		}
+
+		if ((!given_algorithm.empty() && given_algorithm != algorithm) || index_n != n || params.dim != d)
+		{
+			std::cerr << "\nGiven index file was built with algorithm " << algorithm << " on " << index_n << " objects of dimension " << params.dim << ", it does not match the input\n\n";
+			delete snapshot;
+			return EXIT_FAILURE;
+		}
+	}
+
 	if (algorithm.empty())
 	{
 		while (algorithm != "LSH" && algorithm != "Hypercube" && algorithm != "Frechet")
@@ -81,62 +179,168 @@ int main(int argc, char const *argv[])
 
 	// pointer to abstract class search_method object
 	search_method * method;
-	
-	// pointer to metric function to be used
-	double (*metric_function)(const Abstract_Object &, const Abstract_Object &);
 	int numBuckets;
 
+	// grid of the curves (Frechet, or Hypercube given a metric)
+	if (snapshot == nullptr && !metric_func.empty() && !delta)		// if no value was given for delta through command line
+	{
+		if (metric_func == "discrete")
+		{
+			// delta << 4 * dim of grid * min {m1, m2} ,  dim of grid = 2, m1=m2=d for our case
+			delta = (8 * d) * 0.000205479452054;					// experimental value (testing required)
+		}
+		else // metric continuous
+		{
+			// delta << 4 * dim of grid * min {m1, m2} ,  dim of grid = 1, m1=m2=d for our case
+			delta = (4 * d) * 0.000205479452054;					// experimental value (testing required)	
+		}
+	}
+
+	// window of the h hash functions and parameters of a structure built here (a snapshot keeps the ones it was built with)
+	if (snapshot == nullptr)
+	{
+		w = (tuned_w > 0) ? tuned_w : default_window(algorithm);
+		params = global_index_params();
+		params.bucket_load = bucket_load;
+	}
+
+	if (!tune_file.empty())
+	{
+		// tuning mode : structures are built for a grid of parameters around the current ones, and no query file is needed
+		std::cout << "Tuning Parameters       --> \n";
+		if (!tune_parameters(dataset, tune_file, generator))
+		{
+			std::cerr << "\nError occured while writing given tuned file\n\n";
+			return EXIT_FAILURE;
+		}
+		std::cout << "\nTuned parameters written to " << tune_file << "\n";
+		return EXIT_SUCCESS;
+	}
+
+	// the query budget is not part of a snapshot, it is set for every run (as M and probes)
+	params.max_distances = max_distances;
+	params.max_probes = max_probes;
+	params.deadline_ms = deadline_ms;
+
 	// depending on algorithm used, method pointer will point to necessary structure
-	if (algorithm == "LSH")
+	// the metric of each structure is fixed by its strategy type, so it is checked here once and never again in the search loops
+	if (snapshot != nullptr)
+	{
+		// parameters were read from the snapshot header, structure is read from the snapshot so there is nothing to import
+		params.query_directed = (probe_order == "query");
+		if (structure == "Hypercube" && metric_func == "discrete")
+			method = new hypercube<discrete_frechet_strategy>(*snapshot, dataset, params, generator);
+		else if (structure == "Hypercube" && metric_func == "continuous")
+			method = new hypercube<continuous_frechet_strategy>(*snapshot, dataset, params, generator);
+		else if (structure == "Hypercube")
+			method = new hypercube<vector_strategy>(*snapshot, dataset, params, generator);
+		else if (algorithm == "Frechet" && metric_func == "discrete")
+			method = new lsh_struct<discrete_frechet_strategy>(*snapshot, dataset, params);
+		else if (algorithm == "Frechet")
+			method = new lsh_struct<continuous_frechet_strategy>(*snapshot, dataset, params);
+		else
+			method = new lsh_struct<vector_strategy>(*snapshot, dataset, params);
+	}
+	else if (algorithm == "LSH")
 	{
-		w = 20;									// experimental value (testing required)
 		numBuckets = floor(n/16);				// experimental value (testing required)
-		method = new lsh_struct(numBuckets);	// vector-curve lsh to be used, so create entire structure for lsh algorithm
-		metric_function = euclidean;			// metric used is euclidean distance
+		// vector-curve lsh to be used, so create entire structure for lsh algorithm (metric used is euclidean distance)
+		method = new lsh_struct<vector_strategy>(params, numBuckets, generator);
 	}
 	else if (algorithm == "Hypercube")
 	{
-		w = 50;							// experimental value (testing required)
-		method = new hypercube;			// vector-curve hypercube to be used, so create entire structure for hypercube algorithm
-		metric_function = euclidean;	// metric used is euclidean distance	
+		params.query_directed = (probe_order == "query");
+		// vector-curve hypercube to be used, so create entire structure for hypercube algorithm (metric used is euclidean distance)
+		// or curve hypercube, the curves are snapped to the grid of the cube before they are projected to its vertices
+		if (metric_func == "discrete")
+			method = new hypercube<discrete_frechet_strategy>(params, generator);
+		else if (metric_func == "continuous")
+			method = new hypercube<continuous_frechet_strategy>(params, generator);
+		else
+			method = new hypercube<vector_strategy>(params, generator);
 	}
 	else if (algorithm == "Frechet")
 	{
-		w = 40;									// experimental value (testing required)
 		numBuckets = floor(n/16);				// experimental value (testing required)
-		method = new lsh_struct(numBuckets);	// frechet-curve lsh to be used, so create entire structure for lsh algorithm
-
-		if (!delta)		// if no value was given for delta through command line
-		{
-			if (metric_func == "discrete")
-			{
-				// delta << 4 * dim of grid * min {m1, m2} ,  dim of grid = 2, m1=m2=d for our case
-				delta = (8 * d) * 0.000205479452054;					// experimental value (testing required)
-			}
-			else // metric continuous
-			{
-				// delta << 4 * dim of grid * min {m1, m2} ,  dim of grid = 1, m1=m2=d for our case
-				delta = (4 * d) * 0.000205479452054;					// experimental value (testing required)	
-			}
-		}
 
+		// frechet-curve lsh to be used, so create entire structure for lsh algorithm
 		//If the metric function is the continuous frechet, the distance will not be between Abstract Objects but
 		// between fred Curves using the continuous frechet distance of the fred library.
 		// However, for the approximate neighbors, the discrete frechet will be used (but in modified curves unlike the discrete frechet case)
-		metric_function = discrete_frechet;
+		if (metric_func == "discrete")
+			method = new lsh_struct<discrete_frechet_strategy>(params, numBuckets, generator);
+		else
+			method = new lsh_struct<continuous_frechet_strategy>(params, numBuckets, generator);
 	}
 	else	// default
 	{
-		w = 30;									// experimental value (testing required)
 		numBuckets = floor(n/16);				// experimental value (testing required)
-		method = new lsh_struct(numBuckets);	// vector-curve lsh to be used, so create entire structure for lsh algorithm
-		metric_function = euclidean;			// metric used is euclidean distance
+		// vector-curve lsh to be used, so create entire structure for lsh algorithm (metric used is euclidean distance)
+		method = new lsh_struct<vector_strategy>(params, numBuckets, generator);
 	}
 
-	std::cout << "Importing Input Dataset --> ";
-	// import dataset
-	method->import_data(dataset);
-	std::cout << "Completed\n";
+	if (snapshot != nullptr)
+	{
+		std::cout << "Loading Index Snapshot  --> ";
+		bool loaded = snapshot->good();
+		delete snapshot;
+
+		if (!loaded)
+		{
+			std::cerr << "\nGiven index file is corrupted or was not built on the given input file\n\n";
+			delete method;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Completed\n";
+	}
+	else
+	{
+		std::cout << "Importing Input Dataset --> ";
+		// import dataset
+		method->import_data(dataset);
+		std::cout << "Completed\n";
+	}
+
+	if (!delta_file.empty())
+	{
+		int upserted = 0, removed = 0;
+
+		std::cout << "Applying Delta File     --> ";
+		if (!apply_delta_file(delta_file, dataset, *method, upserted, removed))
+		{
+			std::cerr << "\nGiven delta file could not be found, or has an invalid line\n\n";
+			delete method;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Completed (" << upserted << " upserted, " << removed << " removed)\n";
+	}
+
+	// bucket sizes bound the work of the slowest queries
+	std::cout << "\nBucket Statistics       -->\n";
+	method->print_stats(std::cout);
+	std::cout << std::endl;
+
+	if (!save_index.empty())
+	{
+		std::cout << "Saving Index Snapshot   --> ";
+		if (!method->save_index(save_index, dataset))
+		{
+			std::cerr << "\nError occured while writing given index file\n\n";
+			delete method;
+			return EXIT_FAILURE;
+		}
+		std::cout << "Completed\n";
+	}
+
+	if (!server.empty())
+	{
+		// server mode : index stays built, and query requests are answered until the clients are done
+		query_server query_server(*method, dataset, N);
+		bool served = (server == "stdio") ? query_server.run_stdio() : query_server.run_socket(server);
+
+		delete method;
+		return served ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
 
 	bool exit_val = false;
 
@@ -170,8 +374,8 @@ int main(int argc, char const *argv[])
 		}
 
 		std::cout << "Executing ...\n";
-		// execute kNN, range search nearest neighbors algorithms using given metric function
-		if (!method->execute(dataset, query_dataset, output_file, N, 0, metric_function))
+		// execute kNN, range search nearest neighbors algorithms
+		if (!method->execute(dataset, query_dataset, output_file, N, 0))
 		{
 			std::cerr << "\nError occured while opening given output file\n\n";
 			return EXIT_FAILURE;
@@ -0,0 +1,289 @@
+//file:tuner.cpp//
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <chrono>
+#include <cmath>
+#include "tuner.hpp"
+#include "params.hpp"
+#include "search_method.hpp"
+#include "lsh_struct.hpp"
+#include "hypercube_class.hpp"
+#include "strategies.hpp"
+#include "top_k.hpp"
+#include "parallel.hpp"
+
+// picks up to TUNE_QUERIES distinct (not removed) objects of the dataset, to be used as queries
+static std::vector <int> sample_queries(const Dataset & dataset, rng & generator)
+{
+	std::vector <int> ids;
+	for (int i = 0; i < dataset.get_num_of_Objects(); ++i)
+		if (!dataset.is_removed(i))
+			ids.push_back(i);
+
+	// partial fisher-yates shuffle, only the first TUNE_QUERIES positions are needed
+	int num_of_queries = std::min((int) ids.size(), TUNE_QUERIES);
+	for (int i = 0; i < num_of_queries; ++i)
+		std::swap(ids[i], ids[generator.uniform_int(i, ids.size() - 1)]);
+
+	ids.resize(num_of_queries);
+	return ids;
+}
+
+// finds by brute force the TUNE_NEIGHBORS nearest neighbors of each query (the query object itself excluded), with the metric of the strategy
+// (for continuous frechet this is the discrete frechet distance of the filtered curves, the metric the approximate searches rank with)
+// queries are independent, so they are split among the threads
+template <typename Strategy>
+static std::vector <std::unordered_set <const Abstract_Object*> > exact_neighbors(const Dataset & dataset, const std::vector <int> & queries)
+{
+	std::vector <std::unordered_set <const Abstract_Object*> > exact(queries.size());
+
+	parallel_for(queries.size(), parallel_threads(queries.size(), 1), [&](int begin, int end, int thread)
+	{
+		for (int q = begin; q < end; ++q)
+		{
+			const Abstract_Object & query_object = dataset.get_ith_object(queries[q]);
+			top_k nearest(TUNE_NEIGHBORS);
+
+			for (int i = 0; i < dataset.get_num_of_Objects(); ++i)
+				if (i != queries[q] && !dataset.is_removed(i))
+					nearest.push(Strategy::bounded_distance(query_object, dataset.get_ith_object(i), nearest.bound()), &dataset.get_ith_object(i));
+
+			for (auto const& neighbor : nearest.sorted())
+				exact[q].insert(neighbor.second);
+		}
+	});
+
+	return exact;
+}
+
+// runs the approximate search of given structure for every query, and sets recall and time per query of given point
+static void measure(search_method & method, const Dataset & dataset, const std::vector <int> & queries,
+	const std::vector <std::unordered_set <const Abstract_Object*> > & exact, tune_point & point)
+{
+	int found = 0, total = 0;
+
+	auto t_start = std::chrono::high_resolution_clock::now();
+	for (size_t q = 0; q < queries.size(); ++q)
+	{
+		const Abstract_Object * query_object = &dataset.get_ith_object(queries[q]);
+
+		// one neighbor more is asked for, as the query object itself is in the structure and is not counted
+		std::vector <std::pair <double, const Abstract_Object*> > nearest = method.appr_nearest_neighbors(dataset, *query_object, TUNE_NEIGHBORS + 1);
+
+		int counted = 0;
+		for (auto const& neighbor : nearest)
+		{
+			if (std::get<1>(neighbor) == query_object)
+				continue;
+			if (counted++ == TUNE_NEIGHBORS)
+				break;
+			if (exact[q].count(std::get<1>(neighbor)))
+				++found;
+		}
+		total += exact[q].size();
+	}
+	auto t_end = std::chrono::high_resolution_clock::now();
+
+	std::chrono::duration <double, std::milli> time = t_end - t_start;
+	point.recall = total ? (double) found / total : 1.0;
+	point.query_ms = queries.empty() ? 0.0 : time.count() / queries.size();
+	point.memory = method.memory_usage();
+}
+
+// sweeps k, L, w (and delta for curves) of the lsh structure of given strategy
+template <typename Strategy>
+static void sweep_lsh(const Dataset & dataset, const std::vector <int> & queries,
+	const std::vector <std::unordered_set <const Abstract_Object*> > & exact, rng & generator, std::vector <tune_point> & points)
+{
+	const int k_values[] = {2, 4, 6};
+	const int L_values[] = {2, 5, 8};
+	const double w_factors[] = {0.5, 1.0, 2.0};
+	const double delta_factors[] = {0.5, 1.0, 2.0};
+	int num_of_deltas = Strategy::snaps_to_grid ? 3 : 1;		// delta is a parameter of the curves only
+	int numBuckets = std::max(1, dataset.get_num_of_Objects() / 16);		// same number of buckets as search
+
+	for (int di = 0; di < num_of_deltas; ++di)
+		for (double w_factor : w_factors)
+			for (int k_value : k_values)
+				for (int L_value : L_values)
+				{
+					tune_point point;
+					point.params = global_index_params();
+					point.params.k = k_value;
+					point.params.L = L_value;
+					point.params.w = std::max(1, (int) round(w * w_factor));
+					if (Strategy::snaps_to_grid)
+						point.params.delta = delta * delta_factors[di];
+
+					lsh_struct<Strategy> method(point.params, numBuckets, generator);
+					method.import_data(dataset);
+					measure(method, dataset, queries, exact, point);
+					points.push_back(point);
+				}
+}
+
+// sweeps d1 and w of the hypercube of given strategy, and for each cube built its query budget (M and probes)
+template <typename Strategy>
+static void sweep_hypercube(const Dataset & dataset, const std::vector <int> & queries,
+	const std::vector <std::unordered_set <const Abstract_Object*> > & exact, rng & generator, std::vector <tune_point> & points)
+{
+	const int w_values[] = {25, 50, 100};
+	const int d1_offsets[] = {-4, -2, 0};
+	const int probes_values[] = {2, 10, 50, 200};
+	int n = dataset.get_num_of_Objects();
+	const int M_values[] = {100, 1000, std::max(n, 1)};
+
+	// d1 around log2(n), so that vertices hold a few objects each
+	int log_n = (int) round(log2((double) std::max(n, 2)));
+
+	for (int w_value : w_values)
+		for (int d1_offset : d1_offsets)
+		{
+			index_params params = global_index_params();
+			params.w = w_value;
+			params.d1 = std::min(20, std::max(2, log_n + d1_offset));
+
+			hypercube<Strategy> method(params, generator);
+			method.import_data(dataset);
+
+			// the budget only bounds the search, so it is changed without building the cube again
+			for (int M_value : M_values)
+				for (int probes_value : probes_values)
+				{
+					tune_point point;
+					point.params = params;
+					point.params.M = M_value;
+					point.params.probes = std::min(probes_value, 1 << params.d1);
+
+					method.set_budget(point.params.M, point.params.probes);
+					measure(method, dataset, queries, exact, point);
+					points.push_back(point);
+				}
+		}
+}
+
+// runs the sweep of the algorithm with given strategy
+template <typename Strategy>
+static void sweep(const Dataset & dataset, const std::vector <int> & queries, rng & generator, std::vector <tune_point> & points)
+{
+	std::cout << "Computing exact neighbors of " << queries.size() << " sampled queries\n";
+	std::vector <std::unordered_set <const Abstract_Object*> > exact = exact_neighbors<Strategy>(dataset, queries);
+
+	if (algorithm == "Hypercube")
+		sweep_hypercube<Strategy>(dataset, queries, exact, generator, points);
+	else
+		sweep_lsh<Strategy>(dataset, queries, exact, generator, points);
+}
+
+// marks the points not dominated by any other point (better or equal recall, time and memory, and better in one of them)
+static void mark_pareto(std::vector <tune_point> & points)
+{
+	for (tune_point & point : points)
+	{
+		point.pareto = true;
+		for (const tune_point & other : points)
+		{
+			bool no_worse = other.recall >= point.recall && other.query_ms <= point.query_ms && other.memory <= point.memory;
+			bool better = other.recall > point.recall || other.query_ms < point.query_ms || other.memory < point.memory;
+			if (no_worse && better)
+			{
+				point.pareto = false;
+				break;
+			}
+		}
+	}
+}
+
+// returns the fastest point of the frontier with recall at least TUNE_TARGET_RECALL, or the point with the best recall if there is none
+static const tune_point & choose(const std::vector <tune_point> & points)
+{
+	const tune_point * chosen = nullptr;
+
+	for (const tune_point & point : points)
+		if (point.pareto && point.recall >= TUNE_TARGET_RECALL && (chosen == nullptr || point.query_ms < chosen->query_ms))
+			chosen = &point;
+
+	if (chosen == nullptr)
+		for (const tune_point & point : points)
+			if (chosen == nullptr || point.recall > chosen->recall || (point.recall == chosen->recall && point.query_ms < chosen->query_ms))
+				chosen = &point;
+
+	return *chosen;
+}
+
+// prints the parameters of a point that are tuned for the current algorithm
+static void print_params(std::ostream & out, const index_params & params)
+{
+	if (algorithm == "Hypercube")
+		out << "d1 " << std::setw(2) << params.d1 << "  M " << std::setw(6) << params.M << "  probes " << std::setw(4) << params.probes;
+	else
+		out << "k " << params.k << "  L " << params.L;
+
+	out << "  w " << std::setw(3) << params.w;
+	if (!metric_func.empty())
+		out << "  delta " << params.delta;
+}
+
+bool tune_parameters(const Dataset & dataset, const std::string & tuned_file, rng & generator)
+{
+	std::vector <int> queries = sample_queries(dataset, generator);
+	std::vector <tune_point> points;
+
+	if (algorithm == "Hypercube" && metric_func == "discrete")
+		sweep<discrete_frechet_strategy>(dataset, queries, generator, points);
+	else if (algorithm == "Hypercube" && metric_func == "continuous")
+		sweep<continuous_frechet_strategy>(dataset, queries, generator, points);
+	else if (algorithm == "Frechet" && metric_func == "discrete")
+		sweep<discrete_frechet_strategy>(dataset, queries, generator, points);
+	else if (algorithm == "Frechet")
+		sweep<continuous_frechet_strategy>(dataset, queries, generator, points);
+	else
+		sweep<vector_strategy>(dataset, queries, generator, points);
+
+	mark_pareto(points);
+	const tune_point & chosen = choose(points);
+
+	// report of every configuration tried, the pareto frontier is marked with *
+	std::cout << "\nrecall@" << TUNE_NEIGHBORS << "\tms/query\tmemory (KB)\tparameters\n";
+	for (const tune_point & point : points)
+	{
+		std::cout << std::fixed << std::setprecision(3) << point.recall << "\t\t" << point.query_ms << "\t\t" << point.memory / 1024 << "\t\t";
+		print_params(std::cout, point.params);
+		std::cout << (point.pareto ? "  *" : "") << (&point == &chosen ? "  (chosen)" : "") << "\n";
+	}
+	std::cout.unsetf(std::ios_base::floatfield);
+	std::cout << std::setprecision(6);
+
+	std::ofstream file(tuned_file);
+	if (!file.is_open())
+		return false;
+
+	// same form as the configuration file of cluster, the measured values are kept as comments
+	file << "# tuned on " << dataset.get_num_of_Objects() << " objects, " << queries.size() << " sampled queries\n";
+	file << "# recall@" << TUNE_NEIGHBORS << " " << chosen.recall << ", " << chosen.query_ms << " ms per query, " << chosen.memory << " bytes\n";
+	file << "algorithm: " << algorithm << "\n";
+	if (!metric_func.empty())
+		file << "metric: " << metric_func << "\n";
+
+	if (algorithm == "Hypercube")
+	{
+		file << "number_of_hypercube_dimensions: " << chosen.params.d1 << "\n";
+		file << "max_number_M_hypercube: " << chosen.params.M << "\n";
+		file << "number_of_probes: " << chosen.params.probes << "\n";
+	}
+	else
+	{
+		file << "number_of_vector_hash_tables: " << chosen.params.L << "\n";
+		file << "number_of_vector_hash_functions: " << chosen.params.k << "\n";
+	}
+	file << "window: " << chosen.params.w << "\n";
+	if (!metric_func.empty())
+		file << "grid_delta: " << chosen.params.delta << "\n";
+
+	return file.good();
+}
@@ -0,0 +1,38 @@
+//file:tuner.hpp//
+#ifndef _TUNER_HPP_
+#define _TUNER_HPP_
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "dataset.hpp"
+#include "index_params.hpp"
+#include "rng.hpp"
+
+// parameter tuning of the search structures (search -tune <tuned_file>)
+// a sample of the dataset objects is used as queries, and their exact nearest neighbors (the object itself excluded) are found once
+// then a grid of parameters around the current ones is swept, and for each configuration the structure is built
+// and the recall of its approximate neighbors, its time per query and its memory are measured
+// the configurations not dominated in all three are reported as the pareto frontier, and the one chosen is written to the tuned file
+// (as read by read_tuned_file, for search -tuned and cluster -tuned)
+
+#define TUNE_QUERIES 50				// number of dataset objects sampled as queries
+#define TUNE_NEIGHBORS 10			// recall is measured on this many nearest neighbors
+#define TUNE_TARGET_RECALL 0.9		// the fastest configuration of the frontier with at least this recall is chosen (the one with the best recall if none)
+
+// a configuration tried by the tuner, and what was measured for it
+struct tune_point
+{
+	index_params params;		// parameters the structure was built with
+	double recall;				// fraction of the exact nearest neighbors found by the approximate search
+	double query_ms;			// average time of an approximate search in milliseconds
+	uint64_t memory;			// bytes taken by the structure (see search_method::memory_usage)
+	bool pareto;				// true if no other configuration has better or equal recall, time and memory (and better in one of them)
+};
+
+// tunes the parameters of the structure of the current algorithm and metric (global program parameters) on given dataset
+// the grid is centered at the current w and delta (and the default k, L, d1, M, probes), the structures are built with given generator
+// prints all configurations tried and writes the configuration chosen to tuned_file, returns false if tuned_file could not be written
+bool tune_parameters(const Dataset & dataset, const std::string & tuned_file, rng & generator);
+
+#endif